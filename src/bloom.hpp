@@ -0,0 +1,111 @@
+#pragma once
+#ifndef BLOOM_HPP
+#define BLOOM_HPP
+
+#include "mystl.hpp"
+#include "tablespace.hpp"
+
+namespace sjtu {
+
+// 键的 64 位哈希；pair 按成员逐个组合，不碰填充字节
+template <class T> struct KeyHash {
+    static unsigned long long Of(const T &key) { return Mix64(static_cast<unsigned long long>(key)); }
+};
+template <class A, class B> struct KeyHash<pair<A, B>> {
+    static unsigned long long Of(const pair<A, B> &key) {
+        return Mix64(KeyHash<A>::Of(key.first) * 0x9e3779b97f4a7c15ull + KeyHash<B>::Of(key.second));
+    }
+};
+
+// 布隆过滤器：位图常驻内存，持久化在表空间的一个段里（起始块由使用者记录），
+// 写回时只写改过的块。位图算进缓存预算。不支持删除，删掉的键只会让误判变多，由使用者在清空时 Reset。
+// kBYTES 为 0 表示不用过滤器。
+template <int kBYTES> class BloomFilter {
+private:
+    static constexpr int kBLOCK = Tablespace::kBLOCK;
+    static constexpr int kBLOCKS = kBYTES / kBLOCK;
+    static constexpr unsigned long long kMASK = kBYTES * 8ull - 1;
+    static constexpr int kHASHES = 4;
+    static_assert(kBYTES % kBLOCK == 0 && (kBYTES & (kBYTES - 1)) == 0, "filter size must be a power of two of blocks");
+    static_assert(kBLOCKS <= Tablespace::kMAX_RUN, "filter must fit in one run");
+
+    unsigned char *bits;
+    bool dirty[kBLOCKS];
+
+public:
+    BloomFilter() : bits(new unsigned char[kBYTES]()) {
+        for (int i = 0; i < kBLOCKS; i++) {
+            dirty[i] = false;
+        }
+        CacheGovernor::Instance().Reserve(kBYTES);
+    }
+    BloomFilter(const BloomFilter &) = delete;
+    BloomFilter &operator=(const BloomFilter &) = delete;
+    ~BloomFilter() {
+        CacheGovernor::Instance().Reserve(-kBYTES);
+        delete[] bits;
+    }
+
+    // 可以和 MayContain 及别的 Add 并发
+    void Add(unsigned long long h) {
+        unsigned long long step = (h >> 32 | h << 32) | 1;
+        for (int i = 0; i < kHASHES; i++, h += step) {
+            unsigned long long b = h & kMASK;
+            unsigned char bit = 1 << (b & 7);
+            if (bits[b >> 3] & bit) {
+                continue;
+            }
+#ifdef SJTU_CONCURRENT
+            __atomic_fetch_or(&bits[b >> 3], bit, __ATOMIC_RELAXED);
+            __atomic_store_n(&dirty[(b >> 3) / kBLOCK], true, __ATOMIC_RELAXED);
+#else
+            bits[b >> 3] |= bit;
+            dirty[(b >> 3) / kBLOCK] = true;
+#endif
+        }
+    }
+    // 返回 false 时一定不存在
+    bool MayContain(unsigned long long h) const {
+        unsigned long long step = (h >> 32 | h << 32) | 1;
+        for (int i = 0; i < kHASHES; i++, h += step) {
+            unsigned long long b = h & kMASK;
+            if (!(bits[b >> 3] & (1 << (b & 7)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Reset() {
+        __builtin_memset(bits, 0, kBYTES);
+        for (int i = 0; i < kBLOCKS; i++) {
+            dirty[i] = true;
+        }
+    }
+
+    void Load(int block) {
+        Tablespace::Instance().Read(bits, Tablespace::Offset(block), kBYTES);
+    }
+    // 写回改过的块，block 不大于 0 时先分配一段；返回段的起始块
+    int Save(int block) {
+        Tablespace &ts = Tablespace::Instance();
+        if (block <= 0) {
+            block = ts.AllocRun(kBLOCKS);
+            for (int i = 0; i < kBLOCKS; i++) {
+                dirty[i] = true;
+            }
+        }
+        for (int i = 0; i < kBLOCKS; i++) {
+            if (dirty[i]) {
+                ts.Write(bits + i * kBLOCK, Tablespace::Offset(block + i), kBLOCK);
+                dirty[i] = false;
+            }
+        }
+        return block;
+    }
+};
+template <> class BloomFilter<0> {};
+
+} // namespace sjtu
+
+#endif // BLOOM_HPP
@@ -4,74 +4,317 @@
 
 #include <climits>
 #include <string>
-#include <filesystem>
 #include "mystl.hpp"
+#include "tablespace.hpp"
+#include "bufferpool.hpp"
+#include "bloom.hpp"
 
 using string64 = sjtu::MyString<64>;
 using sjtu::MemoryRiver;
 using sjtu::pair;
 using sjtu::vector;
 
-template <class TKey, class TValue, int kPLUS = 4, int kCACHESIZE = 16>
-class BPlusTree {
+// 键的组织方式。MultiKey：按 (键, 值) 排序，一个键可以对应多个值；
+// UniqueKey：一个键只对应一个值，内部节点只存分隔键
+struct MultiKey {
+    static constexpr bool kUNIQUE = false;
+};
+struct UniqueKey {
+    static constexpr bool kUNIQUE = true;
+};
+
+// kBLOOMBYTES 不为 0 时带一个这么大的布隆过滤器，不存在的键不用下降就能判断
+template <class TKey, class TValue, int kPLUS = 4, int kCACHEBYTES = 1 << 20, class TPolicy = MultiKey,
+          int kBLOOMBYTES = 0>
+class BPlusTree : public sjtu::Flusher {
 private:
-    static const int kORDER = ((4096 * kPLUS - 10) / (sizeof(TKey) + sizeof(TValue) + 4) - 1) / 2 * 2 + 1; 
-    static constexpr int kMAX_KEYS = kORDER - 1;
-    static constexpr int kMIN_KEYS = (kORDER + 1) / 2 - 1;
+    static constexpr bool kUNIQUE = TPolicy::kUNIQUE;
+    static constexpr int kPAGE_BYTES = 4096 * kPLUS;
+    static constexpr int kDATA_BYTES = kPAGE_BYTES - 16;
+    static constexpr int kKEY = sizeof(TKey), kVALUE = sizeof(TValue), kVALUE_ALIGN = alignof(TValue);
+    static constexpr int Align(int x, int a) { return (x + a - 1) / a * a; }
+    // 每种节点都多留一个位置，插入后溢出再分裂
+    // 叶子：keys[kLEAF_MAX + 1] | vals[kLEAF_MAX + 1]
+    static constexpr int kLEAF_MAX = (kDATA_BYTES - kVALUE_ALIGN) / (kKEY + kVALUE) - 1;
+    static constexpr int kLEAF_VALS = Align((kLEAF_MAX + 1) * kKEY, kVALUE_ALIGN);
+    // 内部节点：keys[kINNER_MAX + 1] | vals[kINNER_MAX + 1]（仅 MultiKey）| children[kINNER_MAX + 2]
+    static constexpr int kINNER_MAX = kUNIQUE ? (kDATA_BYTES - 8) / (kKEY + 4) - 1
+                                              : (kDATA_BYTES - kVALUE_ALIGN - 8) / (kKEY + kVALUE + 4) - 1;
+    static constexpr int kINNER_VALS = Align((kINNER_MAX + 1) * kKEY, kVALUE_ALIGN);
+    static constexpr int kINNER_CHILDREN = Align(kINNER_VALS + (kUNIQUE ? 0 : (kINNER_MAX + 1) * kVALUE), 4);
+    static constexpr int kLEAF_MIN = kLEAF_MAX / 2;
+    static constexpr int kINNER_MIN = kINNER_MAX / 2;
+    // 批量装载时每个节点的装填上限
+    static constexpr int kLEAF_FILL = kLEAF_MAX - kLEAF_MAX / 8;
+    static constexpr int kINNER_FILL = kINNER_MAX - kINNER_MAX / 8;
+    static_assert(kLEAF_VALS + (kLEAF_MAX + 1) * kVALUE <= kDATA_BYTES, "leaf layout overflows the page");
+    static_assert(kINNER_CHILDREN + (kINNER_MAX + 2) * 4 <= kDATA_BYTES, "inner layout overflows the page");
+    static_assert(kLEAF_MAX >= 3 && kINNER_MAX >= 3, "page too small for the key/value types");
     using kv_type = pair<TKey, TValue>;
+    static constexpr int kMAX_DEPTH = 32;
+    static constexpr int kREADAHEAD = 4;  // 游标跨叶子后预读的叶子数（只在有 POSIX 接口时）
+    static constexpr int kBLOOM_INFO = 1;  // info 中记录布隆过滤器所在段的位置，0 表示没有
+    static constexpr int kWARM_INFO = 3;   // info 中记录预热列表所在块的位置，0 表示没有
 
-    struct Node {
+    // 一个节点正好一页，在内存中也按页对齐（可以直接用于 O_DIRECT）。
+    // 键和值分开存放，节点内查找只需扫描连续的键数组；
+    // 叶子和内部节点的容量不同，数组在 data 中的位置由 isleaf 决定
+    struct alignas(sjtu::Pager::kBLOCK) Node {
         bool isleaf;
         int keycount;
-        kv_type kvs[kMAX_KEYS + 2]{}; // first key, second value
-        int children[kORDER + 2];
         int next;
+        alignas(8) char data[kDATA_BYTES];
 
-        Node(bool leaf = true) : isleaf(leaf), keycount(0), next(-1) {
-            for (int i = 0; i < kORDER; i++)
-                children[i] = -1;
+        Node(bool leaf = true) : isleaf(leaf), keycount(0), next(-1) {}
+        TKey *keys() { return reinterpret_cast<TKey *>(data); }
+        TValue *vals() { return reinterpret_cast<TValue *>(data + (isleaf ? kLEAF_VALS : kINNER_VALS)); }
+        int *children() { return reinterpret_cast<int *>(data + kINNER_CHILDREN); }
+        bool HasVals() const { return isleaf || !kUNIQUE; }
+        int MaxKeys() const { return isleaf ? kLEAF_MAX : kINNER_MAX; }
+        int MinKeys() const { return isleaf ? kLEAF_MIN : kINNER_MIN; }
+        kv_type Kv(int i) { return {keys()[i], HasVals() ? vals()[i] : TValue()}; }
+        void Set(int i, const kv_type &kv) {
+            keys()[i] = kv.first;
+            if (HasVals()) {
+                vals()[i] = kv.second;
+            }
+        }
+        void Set(int i, Node &other, int j) {
+            keys()[i] = other.keys()[j];
+            if (HasVals()) {
+                vals()[i] = other.vals()[j];
+            }
         }
     };
+    static_assert(sizeof(Node) == kPAGE_BYTES, "node must fill exactly one page");
+    using Pool = sjtu::BufferPool<Node, MemoryRiver<Node>>;
+    using Page = typename Pool::Handle;
+
+    // 从根到叶的下降路径：pos[d] 为第 d 层的节点，idx[d] 为它在 pos[d - 1] 中的孩子下标
+    struct Path {
+        int depth = 0;
+        int pos[kMAX_DEPTH];
+        int idx[kMAX_DEPTH];
+    };
+
+    // 关闭时缓存里的页，占表空间的一个块
+    struct WarmList {
+        int count;
+        int pos[sjtu::Tablespace::kBLOCK / sizeof(int) - 1];
+    };
+    static constexpr int kWARM_PAGES = sizeof(WarmList::pos) / sizeof(int);
+
     MemoryRiver<Node> file;
+    Pool pool{&file, kCACHEBYTES};
+    sjtu::BloomFilter<kBLOOMBYTES> bloom;
     int rootpos;
+    // 并发（SJTU_CONCURRENT）：每个操作先拿 treelatch。读和只动一个叶子的写（不分裂、不合并）拿共享闩，
+    // 再给叶子加页闩；会改内部节点或根的操作拿独占闩，此时树上没有别的操作，不再加页闩。
+    // 所以内部节点在共享闩下不会变，读它们不用页闩。smo 在每次独占修改时加一，
+    // 乐观尝试失败后据此判断刚才记下的路径还能不能用
+    sjtu::Latch treelatch;
+    int smo = 0;
+    // 启动以来的统计，descents 为从根下降到叶子的次数
+    sjtu::Counter splits, merges, descents;
+
+    // 第一个键不小于 key 的位置
+    static int KeyLowerBound(Node &node, const TKey &key) {
+        return sjtu::KeySearch<TKey>::LowerBound(node.keys(), node.keycount, key);
+    }
+    // 键等于 key 的区间 [lo, hi)
+    static pair<int, int> KeyRange(Node &node, const TKey &key) {
+        int lo = KeyLowerBound(node, key);
+        if (lo == node.keycount || node.keys()[lo] > key) {
+            return {lo, lo};
+        }
+        return {lo, lo + sjtu::upper_bound(node.keys() + lo, node.keycount - lo, key)};
+    }
+    // 第一个键大于 key 的位置
+    static int KeyUpperBound(Node &node, const TKey &key) {
+        return sjtu::upper_bound(node.keys(), node.keycount, key);
+    }
+    // 以下按树的排序方式比较：UniqueKey 只看键
+    static bool KvLess(const kv_type &a, const kv_type &b) {
+        if (kUNIQUE || a.first != b.first) {
+            return a.first < b.first;
+        }
+        return a.second < b.second;
+    }
+    static bool KvEqual(const kv_type &a, const kv_type &b) {
+        return a.first == b.first && (kUNIQUE || a.second == b.second);
+    }
+    // 节点第 i 个位置是否就是 (key, value)
+    static bool Match(Node &node, int i, const TKey &key, const TValue &value) {
+        return i < node.keycount && node.keys()[i] == key && (kUNIQUE || node.vals()[i] == value);
+    }
+    // 第一个 (键, 值) 不小于 (key, value) 的位置
+    static int LowerBound(Node &node, const TKey &key, const TValue &value) {
+        if constexpr (kUNIQUE) {
+            return KeyLowerBound(node, key);
+        }
+        auto [lo, hi] = KeyRange(node, key);
+        return lo + sjtu::lower_bound(node.vals() + lo, hi - lo, value);
+    }
+    // 第一个 (键, 值) 大于 (key, value) 的位置，内部节点按它选择子树
+    static int UpperBound(Node &node, const TKey &key, const TValue &value) {
+        if constexpr (kUNIQUE) {
+            return KeyUpperBound(node, key);
+        }
+        auto [lo, hi] = KeyRange(node, key);
+        return lo + sjtu::upper_bound(node.vals() + lo, hi - lo, value);
+    }
+
+    // 在叶子里放入 (key, value)，返回是否新增了一项（可能溢出一个位置）
+    static bool PutLeaf(Page &leaf, const TKey &key, const TValue &value, bool overwrite) {
+        int i = LowerBound(*leaf, key, value);
+        if (Match(*leaf, i, key, value)) {
+            if (overwrite) {
+                leaf->vals()[i] = value;
+                leaf.MarkDirty();
+            }
+            return false;
+        }
+        for (int k = leaf->keycount; k > i; k--) {
+            leaf->Set(k, *leaf, k - 1);
+        }
+        leaf->keys()[i] = key;
+        leaf->vals()[i] = value;
+        leaf->keycount++;
+        leaf.MarkDirty();
+        return true;
+    }
+    // 删除叶子的第 i 项
+    static void EraseLeaf(Page &leaf, int i) {
+        for (int k = i; k < leaf->keycount - 1; k++) {
+            leaf->Set(k, *leaf, k + 1);
+        }
+        leaf->keycount--;
+        leaf.MarkDirty();
+    }
+
+    void BloomAdd(const TKey &key) {
+        if constexpr (kBLOOMBYTES > 0) {
+            bloom.Add(sjtu::KeyHash<TKey>::Of(key));
+        }
+    }
+    // 布隆过滤器确定 key 不存在
+    bool Absent(const TKey &key) {
+        if constexpr (kBLOOMBYTES > 0) {
+            return !bloom.MayContain(sjtu::KeyHash<TKey>::Of(key));
+        }
+        return false;
+    }
+    // 过滤器没有存下来（旧的数据文件）时扫一遍叶子重建
+    void LoadBloom() {
+        int block;
+        file.get_info(block, kBLOOM_INFO);
+        if (block > 0) {
+            bloom.Load(block);
+            return;
+        }
+        bloom.Reset();
+        int pos = rootpos;
+        while (true) {
+            Page node = FetchNode(pos);
+            if (node->isleaf) {
+                break;
+            }
+            pos = node->children()[0];
+        }
+        while (pos >= 0) {
+            Page node = FetchNode(pos);
+            for (int i = 0; i < node->keycount; i++) {
+                BloomAdd(node->keys()[i]);
+            }
+            pos = node->next;
+        }
+    }
 
-    struct Cache {
-        bool used;
-        int pos;
-        Node node;
-        int lstuse;
-        Cache() : used(0), pos(-1), lstuse(0) {};
-    } cache[kCACHESIZE];
-    int usecnt = 1;
+    // 记下缓存里的页，下次启动时预读
+    void SaveWarm() {
+        sjtu::Tablespace &ts = sjtu::Tablespace::Instance();
+        int block;
+        file.get_info(block, kWARM_INFO);
+        if (block <= 0) {
+            block = ts.AllocRun(1);
+            file.write_info(block, kWARM_INFO);
+        }
+        WarmList list;
+        list.count = pool.Resident(list.pos, kWARM_PAGES);
+        ts.Write(&list, sjtu::Tablespace::Offset(block), sizeof(list));
+    }
+    // 按文件顺序把上次关闭时缓存里的页读进缓存池，池满了以后剩下的只提示内核预读
+    void LoadWarm() {
+        int block;
+        file.get_info(block, kWARM_INFO);
+        if (block <= 0) {
+            return;
+        }
+        WarmList list;
+        sjtu::Tablespace::Instance().Read(&list, sjtu::Tablespace::Offset(block), sizeof(list));
+        vector<int> ids;
+        for (int i = 0; i < list.count && i < kWARM_PAGES; i++) {
+            if (list.pos[i] >= 0 && list.pos[i] < file.size()) {
+                ids.push_back(list.pos[i]);
+            }
+        }
+        merge_sort(ids, [](int a, int b) { return a < b; });
+        for (int i = 0; i < ids.size(); i++) {
+            if (!pool.Preload(ids[i])) {
+                pool.Prefetch(ids[i]);
+            }
+        }
+    }
 
 public:
-    BPlusTree(const std::string &filename) {
-        // std::cerr << "test " << filename << " " << kORDER << "\n";
-        if (!std::filesystem::exists(filename)) {
-            file.initialise(filename, 1);
-            Node root;
-            rootpos = AddNode(root);
+    // filename 是树在表空间目录里的名字，没有记录时建一棵空树
+    explicit BPlusTree(const std::string &filename) {
+        file.initialise(filename, 1);
+        if (file.size() == 0) {
+            NewNode(rootpos, true);
         } else {
-            file.initialise(filename, 1);
             file.get_info(rootpos, 2);
-            Node root;
-            root = ReadNode(rootpos);
+            if constexpr (kBLOOMBYTES > 0) {
+                LoadBloom();
+            }
+            LoadWarm();
         }
+        sjtu::Tablespace::Instance().Attach(this);
     }
     ~BPlusTree() {
-        Node root;
-        root = ReadNode(rootpos);
+        sjtu::Tablespace::Instance().Detach(this);
+        SaveWarm();
+        Flush();
+    }
+
+    // 把缓存中的脏页和根位置写进表空间，组提交时调用
+    void Flush() override {
+        sjtu::LatchGuard exclusive(treelatch, true);
+        pool.Flush();
         file.write_info(rootpos, 2);
+        if constexpr (kBLOOMBYTES > 0) {
+            int block;
+            file.get_info(block, kBLOOM_INFO);
+            file.write_info(bloom.Save(block), kBLOOM_INFO);
+        }
     }
 
     void Clear() {
-        usecnt = 0;
-        for (int i = 0; i < kCACHESIZE; i++) {
-            cache[i].used = 0;
+        sjtu::LatchGuard exclusive(treelatch, true);
+        smo++;
+        pool.Reset();
+        int block;
+        file.get_info(block, kWARM_INFO);
+        if (block > 0) {
+            sjtu::Tablespace::Instance().FreeRun(block, 1);
         }
+        file.get_info(block, kBLOOM_INFO);
         file.clear();
-        Node root;
-        rootpos = AddNode(root);
+        file.write_info(block, kBLOOM_INFO);
+        if constexpr (kBLOOMBYTES > 0) {
+            bloom.Reset();
+        }
+        NewNode(rootpos, true);
     }
 
     void AddInfo(int x) {
@@ -83,382 +326,736 @@ public:
         return tmp;
     }
 
+    // 一行统计。full 时扫一遍叶子算平均装填率（会把叶子都读一遍），否则只给高度和计数
+    void Stats(std::ostream &os, bool full) {
+        sjtu::LatchGuard shared(treelatch, false);
+        int height = 1, pos = rootpos;
+        while (true) {
+            Page node = FetchNode(pos);
+            if (node->isleaf) {
+                break;
+            }
+            pos = node->children()[0];
+            height++;
+        }
+        os << file.name() << " tree height=" << height << " pages=" << file.size()
+           << " bytes=" << static_cast<long long>(file.size()) * kPAGE_BYTES;
+        if (full) {
+            long long leaves = 0, entries = 0;
+            for (; pos >= 0; leaves++) {
+                Page node = FetchNode(pos);
+                entries += node->keycount;
+                pos = node->next;
+            }
+            os << " leaves=" << leaves << " entries=" << entries << " fill=" << entries * 100 / (leaves * kLEAF_MAX) << "%";
+        }
+        long long hits, misses, writes, promotions;
+        pool.Counters(hits, misses, writes, promotions);
+        os << " cache=" << pool.Limit() << " hits=" << hits << " misses=" << misses << " writes=" << writes
+           << " promotions=" << promotions
+           << " splits=" << splits.Get() << " merges=" << merges.Get() << " descents=" << descents.Get() << "\n";
+    }
+
     bool Empty() {
-        Node root = ReadNode(rootpos);
-        return root.isleaf && root.keycount == 0;
+        sjtu::LatchGuard shared(treelatch, false);
+        Page root = FetchNode(rootpos);
+        root.LockShared();
+        return root->isleaf && root->keycount == 0;
     }
 
+    // 插入 (key, value)，已存在时不做任何事
     void Insert(const TKey &key, const TValue &value) {
-        Node root = ReadNode(rootpos);
-        if (root.isleaf && root.keycount == 0) {
-            root.kvs[0] = {key, value};
-            root.keycount = 1;
-            WriteNode(rootpos, root);
-            root = ReadNode(rootpos);
+        Upsert(key, value, false);
+    }
+    // UniqueKey：插入或覆盖 key 对应的值
+    void Put(const TKey &key, const TValue &value) {
+        Upsert(key, value, true);
+    }
+    // UniqueKey：取 key 对应的值（MultiKey 下为最小的那个）
+    pair<TValue, bool> Get(const TKey &key) {
+        if (Absent(key)) {
+            return {TValue(), false};
+        }
+        auto it = Seek(key);
+        if (!it.Valid() || it.Key() != key) {
+            return {TValue(), false};
+        }
+        return {it.Value(), true};
+    }
+    // UniqueKey：原地修改 key 对应的值，mutator 不能改变排序
+    template <class F>
+    bool Update(const TKey &key, F mutator) {
+        if (Absent(key)) {
+            return false;
+        }
+        auto it = Seek(key, true);
+        if (!it.Valid() || it.Key() != key) {
+            return false;
+        }
+        mutator(it.Value());
+        it.leaf.MarkDirty();
+        return true;
+    }
+
+    // 按 (key, value) 直接下降到这一项所在的叶子，原地用 mutator 修改值；mutator 不能改变排序
+    template <class F>
+    bool Update(const TKey &key, const TValue &value, F mutator) {
+        if (Absent(key)) {
+            return false;
+        }
+        sjtu::LatchGuard shared(treelatch, false);
+        Path path;
+        Page leaf = Descend(path, key, value);
+        leaf.Lock();
+        int i = LowerBound(*leaf, key, value);
+        if (!Match(*leaf, i, key, value)) {
+            return false;
+        }
+        mutator(leaf->vals()[i]);
+        leaf.MarkDirty();
+        return true;
+    }
+
+    void Upsert(const TKey &key, const TValue &value, bool overwrite) {
+        BloomAdd(key);
+        Path path;
+        Page leaf;
+        int seen;
+        {
+            // 先只锁叶子，不用分裂就在这里完成
+            sjtu::LatchGuard shared(treelatch, false);
+            seen = smo;
+            leaf = Descend(path, key, value);
+            leaf.Lock();
+            if (leaf->keycount < kLEAF_MAX || Match(*leaf, LowerBound(*leaf, key, value), key, value)) {
+                PutLeaf(leaf, key, value, overwrite);
+                leaf.Release();
+                return;
+            }
+            leaf.Unlock();
+        }
+        // 叶子满了：独占整棵树重做，结构没变过就沿用刚才的路径和叶子（一直 pin 着）
+        sjtu::LatchGuard exclusive(treelatch, true);
+        if (smo++ != seen) {
+            leaf = Descend(path, key, value);
+        }
+        if (!PutLeaf(leaf, key, value, overwrite) || leaf->keycount <= kLEAF_MAX) {
             return;
         }
-        auto [newkvs, newpos] = InsertRec(rootpos, key, value);
-        if (newpos != -1) {
-            Node newroot(false);
-            newroot.keycount = 1;
-            newroot.kvs[0] = newkvs;
-            newroot.children[0] = rootpos;
-            newroot.children[1] = newpos;
-            rootpos = AddNode(newroot);
-        }
-    }
-
-    pair<kv_type, int> InsertRec(int pos, const TKey &key, const TValue &value) {
-        Node node = ReadNode(pos);
-        if (node.isleaf) {
-            int i = 0;
-            while (i < node.keycount && node.kvs[i] < pair{key, value}) {
-                i++;
-            }
-            // std::cerr << "   InsertRec: " << node.keycount << " " << i << "\n";
-            if (i < node.keycount && node.kvs[i] == pair{key, value})
-                return {kv_type(), -1};
-            for (int k = node.keycount; k > i; k--) {
-                node.kvs[k] = node.kvs[k - 1];
-            }
-            node.kvs[i] = {key, value};
-            node.keycount++;
-            if (node.keycount <= kMAX_KEYS) {
-                WriteNode(pos, node);
-                return {kv_type(), -1};
-            }
-            int mid = node.keycount / 2;
-            Node newleaf;
-            newleaf.isleaf = true;
-            newleaf.keycount = node.keycount - mid;
-            for (int k = 0; k < newleaf.keycount; k++) {
-                newleaf.kvs[k] = node.kvs[mid + k];
-            }
-            node.keycount = mid;
-            newleaf.next = node.next;
-            int newpos = AddNode(newleaf);
-            node.next = newpos;
-            WriteNode(pos, node);
-            return {newleaf.kvs[0], newpos};
-        } else {
-            int i = 0;
-            while (i < node.keycount && node.kvs[i] < pair{key, value}) {
-                i++;
+        auto [sep, newpos] = SplitLeaf(leaf);
+        leaf.Release();
+        InsertUp(path, path.depth - 1, sep, newpos);
+    }
+
+    // 批量插入按 (key, value) 升序排好的键值对，已存在的跳过。
+    // 空树直接自底向上建树；否则每次下降到叶子后，把落在该叶子范围内的一段一次归并进去，
+    // 叶子满了才分裂（顺序插入时左边尽量多留，但两边都不少于 kLEAF_MIN），然后重新下降。
+    void InsertSorted(vector<kv_type> &items) {
+        if (items.empty()) {
+            return;
+        }
+        sjtu::LatchGuard exclusive(treelatch, true);
+        smo++;
+        for (int k = 0; k < (int)items.size(); k++) {
+            BloomAdd(items[k].first);
+        }
+        if (Page root = FetchNode(rootpos); root->isleaf && root->keycount == 0) {
+            root.Release();
+            BulkLoad(items);
+            return;
+        }
+        vector<int> fresh;
+        int i = 0, n = items.size();
+        while (i < n) {
+            Path path;
+            Page leaf = Descend(path, items[i].first, items[i].second);
+            // 叶子范围的上界是路径上离它最近的右侧分隔键
+            bool bounded = false;
+            kv_type fence;
+            for (int d = path.depth - 1; d >= 0; d--) {
+                Page node = FetchNode(path.pos[d]);
+                if (path.idx[d + 1] < node->keycount) {
+                    bounded = true;
+                    fence = node->Kv(path.idx[d + 1]);
+                    break;
+                }
             }
-            auto [newkvs, newchild] = InsertRec(node.children[i], key, value);
-            if (newchild == -1) {
-                return {kv_type(), -1};
+            int room = kLEAF_MAX - leaf->keycount;
+            if (room == 0) {
+                int k = LowerBound(*leaf, items[i].first, items[i].second);
+                if (Match(*leaf, k, items[i].first, items[i].second)) {
+                    i++;
+                    continue;
+                }
+                for (int t = leaf->keycount; t > k; t--) {
+                    leaf->Set(t, *leaf, t - 1);
+                }
+                leaf->Set(k, items[i++]);
+                leaf->keycount++;
+                int mid = k + 1 < kLEAF_FILL ? k + 1 : kLEAF_FILL;
+                if (mid < leaf->keycount / 2) {
+                    mid = leaf->keycount / 2;
+                }
+                if (mid > leaf->keycount - kLEAF_MIN) {
+                    mid = leaf->keycount - kLEAF_MIN;
+                }
+                auto [sep, newpos] = SplitLeaf(leaf, mid);
+                leaf.Release();
+                InsertUp(path, path.depth - 1, sep, newpos);
+                continue;
             }
-            for (int k = node.keycount; k > i; k--) {
-                node.kvs[k] = node.kvs[k - 1];
-                node.children[k + 1] = node.children[k];
+            fresh.clear();
+            for (; i < n && (int)fresh.size() < room && (!bounded || KvLess(items[i], fence)); i++) {
+                if (i > 0 && KvEqual(items[i], items[i - 1])) {
+                    continue;
+                }
+                int k = LowerBound(*leaf, items[i].first, items[i].second);
+                if (Match(*leaf, k, items[i].first, items[i].second)) {
+                    continue;
+                }
+                fresh.push_back(i);
             }
-            node.kvs[i] = newkvs;
-            node.children[i + 1] = newchild;
-            node.keycount++;
-            if (node.keycount <= kMAX_KEYS) {
-                WriteNode(pos, node);
-                return {kv_type(), -1};
+            if (fresh.empty()) {
+                continue;
             }
-            int mid = node.keycount / 2;
-            Node newnode(false);
-            newnode.keycount = node.keycount - mid - 1;
-            for (int k = 0; k < newnode.keycount; k++) {
-                newnode.kvs[k] = node.kvs[mid + 1 + k];
-                newnode.children[k] = node.children[mid + 1 + k];
+            // 从后往前归并
+            int a = leaf->keycount - 1, w = leaf->keycount + (int)fresh.size() - 1;
+            for (int b = (int)fresh.size() - 1; b >= 0; b--) {
+                kv_type &item = items[fresh[b]];
+                while (a >= 0 && KvLess(item, leaf->Kv(a))) {
+                    leaf->Set(w--, *leaf, a--);
+                }
+                leaf->Set(w--, item);
             }
-            newnode.children[newnode.keycount] = node.children[node.keycount];
-            kv_type promote = node.kvs[mid];
-            node.keycount = mid;
-            WriteNode(pos, node);
-            int newpos = AddNode(newnode);
-            return {promote, newpos};
+            leaf->keycount += fresh.size();
+            leaf.MarkDirty();
         }
     }
 
-    bool Remove(const TKey &key, const TValue &value) {
-        return RemoveRec(rootpos, pair{key, value});
-    }
-
-    bool RemoveRec(int pos, const kv_type &item, int parent = -1, int idx = -1, const Node &p = Node(false)) {
-        Node node = ReadNode(pos);
-        if (node.isleaf) {
-            int i = 0;
-            while (i < node.keycount && node.kvs[i] < item) {
-                i++;
+    // 空树自底向上建树：叶子按 kLEAF_FILL 均匀装填并串成链表，再逐层建内部节点。
+    // 节点数再少也保证每个非根节点不低于下限，删除时的合并逻辑依赖这一点。
+    // 由 InsertSorted 在独占整棵树时调用
+    void BulkLoad(vector<kv_type> &items) {
+        int n = 0;
+        for (int i = 0; i < (int)items.size(); i++) {
+            if (n == 0 || !KvEqual(items[n - 1], items[i])) {
+                items[n++] = items[i];
             }
-            if (i == node.keycount || node.kvs[i] != item) {
-                return false;
+        }
+        if (n == 0) {
+            return;
+        }
+        vector<pair<int, kv_type>> level, upper;  // (节点位置, 子树中最小的键值对)
+        {
+            int leaves = (n + kLEAF_FILL - 1) / kLEAF_FILL;
+            if (leaves > 1 && leaves > n / kLEAF_MIN) {
+                leaves = n / kLEAF_MIN;
             }
-            for (int k = i; k < node.keycount - 1; k++) {
-                node.kvs[k] = node.kvs[k + 1];
+            Page prev;
+            for (int l = 0, i = 0; l < leaves; l++) {
+                int cnt = (n - i) / (leaves - l), pos;
+                Page leaf = NewNode(pos, true);
+                for (int k = 0; k < cnt; k++) {
+                    leaf->Set(k, items[i + k]);
+                }
+                leaf->keycount = cnt;
+                if (prev) {
+                    prev->next = pos;
+                }
+                level.push_back({pos, items[i]});
+                i += cnt;
+                prev = std::move(leaf);
             }
-            node.keycount--;
-            WriteNode(pos, node);
-            if (node.keycount < kMIN_KEYS) {
-                RebalanceLeaf(parent, idx, pos, p, node);
+        }
+        while (level.size() > 1) {
+            int m = level.size();
+            int groups = (m + kINNER_FILL) / (kINNER_FILL + 1);
+            if (groups > 1 && groups > m / (kINNER_MIN + 1)) {
+                groups = m / (kINNER_MIN + 1);
             }
-            return true;
-        } else {
-            int i = 0;
-            while (i < node.keycount && node.kvs[i] <= item) {
-                i++;
+            upper.clear();
+            for (int g = 0, i = 0; g < groups; g++) {
+                int cnt = (m - i) / (groups - g), pos;
+                Page node = NewNode(pos, false);
+                node->children()[0] = level[i].first;
+                for (int k = 1; k < cnt; k++) {
+                    node->Set(k - 1, level[i + k].second);
+                    node->children()[k] = level[i + k].first;
+                }
+                node->keycount = cnt - 1;
+                upper.push_back({pos, level[i].second});
+                i += cnt;
             }
-            bool merged = RemoveRec(node.children[i], item, pos, i, node);
-            if (!merged) {
+            level = upper;
+        }
+        int oldroot = rootpos;
+        rootpos = level[0].first;
+        FreeNode(oldroot);
+    }
+
+    bool Remove(const TKey &key, const TValue &value) {
+        Path path;
+        Page leaf;
+        int seen;
+        {
+            sjtu::LatchGuard shared(treelatch, false);
+            seen = smo;
+            leaf = Descend(path, key, value);
+            leaf.Lock();
+            int i = LowerBound(*leaf, key, value);
+            if (!Match(*leaf, i, key, value)) {
+                leaf.Release();
                 return false;
             }
-            // if (pos == rootpos) {
-            //     return false;
-            // }
+            if (leaf->keycount > kLEAF_MIN || path.depth == 0) {
+                EraseLeaf(leaf, i);
+                leaf.Release();
+                return true;
+            }
+            leaf.Unlock();
+        }
+        // 删除后叶子不足，要借或合并
+        sjtu::LatchGuard exclusive(treelatch, true);
+        if (smo++ != seen) {
+            leaf = Descend(path, key, value);
+        }
+        int i = LowerBound(*leaf, key, value);
+        if (!Match(*leaf, i, key, value)) {
+            return false;
+        }
+        EraseLeaf(leaf, i);
+        if (leaf->keycount >= kLEAF_MIN) {
             return true;
         }
+        leaf.Release();
+        Underflow(path, path.depth);
+        return true;
     }
 
-    void RebalanceLeaf(int parent, int idx, int pos, Node p, Node now) {
-        if (parent == -1) return;
-        int left = (idx > 0 ? p.children[idx - 1] : -1),
-            right = (idx < p.keycount ? p.children[idx + 1] : -1);
-        if (left != -1) {
-            Node ls = ReadNode(left);
-            if (ls.keycount > kMIN_KEYS) {
-                for (int k = now.keycount; k > 0; k--) {
-                    now.kvs[k] = now.kvs[k - 1];
-                }
-                now.kvs[0] = ls.kvs[ls.keycount - 1];
-                now.keycount++;
-                ls.keycount--;
-                WriteNode(left, ls);
-                WriteNode(pos, now);
-                p.kvs[idx - 1] = now.kvs[0];
-                WriteNode(parent, p);
+    // 按 (key, value) 从根走到叶，记录整条路径，返回 pin 住的叶子。
+    // 调用者直接用它，不要再 pin 一次，否则叶子会被当成第二次访问提升到主队列
+    Page Descend(Path &path, const TKey &key, const TValue &value) {
+        descents.Add();
+        path.depth = 0;
+        path.pos[0] = rootpos;
+        path.idx[0] = -1;
+        while (true) {
+            Page node = FetchNode(path.pos[path.depth]);
+            if (node->isleaf) {
+                return node;
+            }
+            int i = UpperBound(*node, key, value);
+            path.depth++;
+            path.pos[path.depth] = node->children()[i];
+            path.idx[path.depth] = i;
+        }
+    }
+
+    // 叶子从 mid 处分裂（默认对半），返回右半边的第一个键值对和新节点位置
+    pair<kv_type, int> SplitLeaf(Page &node, int mid = -1) {
+        splits.Add();
+        if (mid < 0) {
+            mid = node->keycount / 2;
+        }
+        int newpos;
+        Page newleaf = NewNode(newpos, true);
+        newleaf->keycount = node->keycount - mid;
+        for (int k = 0; k < newleaf->keycount; k++) {
+            newleaf->Set(k, *node, mid + k);
+        }
+        node->keycount = mid;
+        newleaf->next = node->next;
+        node->next = newpos;
+        node.MarkDirty();
+        return {newleaf->Kv(0), newpos};
+    }
+    // 内部节点分裂，返回上提的键值对和新节点位置
+    pair<kv_type, int> SplitInternal(Page &node) {
+        splits.Add();
+        int mid = node->keycount / 2;
+        int newpos;
+        Page newnode = NewNode(newpos, false);
+        newnode->keycount = node->keycount - mid - 1;
+        for (int k = 0; k < newnode->keycount; k++) {
+            newnode->Set(k, *node, mid + 1 + k);
+            newnode->children()[k] = node->children()[mid + 1 + k];
+        }
+        newnode->children()[newnode->keycount] = node->children()[node->keycount];
+        kv_type promote = node->Kv(mid);
+        node->keycount = mid;
+        node.MarkDirty();
+        return {promote, newpos};
+    }
+
+    // 把第 d + 1 层分裂出的 (sep, child) 插入路径上第 d 层的节点，溢出则继续向上
+    void InsertUp(const Path &path, int d, kv_type sep, int child) {
+        for (; d >= 0; d--) {
+            Page node = FetchNode(path.pos[d]);
+            int i = path.idx[d + 1];
+            for (int k = node->keycount; k > i; k--) {
+                node->Set(k, *node, k - 1);
+                node->children()[k + 1] = node->children()[k];
+            }
+            node->Set(i, sep);
+            node->children()[i + 1] = child;
+            node->keycount++;
+            node.MarkDirty();
+            if (node->keycount <= kINNER_MAX) {
                 return;
             }
+            auto [promote, newpos] = SplitInternal(node);
+            sep = promote;
+            child = newpos;
         }
-        if (right != -1) {
-            Node rs = ReadNode(right);
-            if (rs.keycount > kMIN_KEYS) {
-                now.kvs[now.keycount] = rs.kvs[0];
-                now.keycount++;
-                for (int k = 0; k < rs.keycount - 1; k++) {
-                    rs.kvs[k] = rs.kvs[k + 1];
+        int oldroot = rootpos;
+        Page newroot = NewNode(rootpos, false);
+        newroot->keycount = 1;
+        newroot->Set(0, sep);
+        newroot->children()[0] = oldroot;
+        newroot->children()[1] = child;
+    }
+
+    // 路径上第 d 层节点 key 数不足：先向兄弟借，借不到就与兄弟合并，
+    // 父节点因此不足时沿路径继续向上处理
+    void Underflow(const Path &path, int d) {
+        for (; d > 0; d--) {
+            int parentpos = path.pos[d - 1], idx = path.idx[d];
+            Page p = FetchNode(parentpos);
+            {
+                Page now = FetchNode(path.pos[d]);
+                if (Borrow(p, idx, now)) {
+                    return;
                 }
-                rs.keycount--;
-                WriteNode(right, rs);
-                WriteNode(pos, now);
-                p.kvs[idx] = rs.kvs[0];
-                WriteNode(parent, p);
+            }
+            if (p->keycount <= 0) {
+                return;
+            }
+            MergeChildren(p, idx > 0 ? idx - 1 : idx);
+            if (d - 1 == 0) {
+                if (!p->keycount) {
+                    rootpos = p->children()[0];
+                    p.Release();
+                    FreeNode(parentpos);
+                }
+                return;
+            }
+            if (p->keycount >= kINNER_MIN) {
                 return;
             }
-        }
-        if (left != -1) {
-            MergeNode(parent, idx - 1, idx);
-        } else if (right != -1) {
-            MergeNode(parent, idx, idx);
         }
     }
 
-    void RebalanceInternal(int parentpos, int idx, Node p, Node now) {
-        if (parentpos == -1) return;
-        int pos = p.children[idx];
-        int left = (idx > 0 ? p.children[idx - 1] : -1);
-        int right = (idx < p.keycount ? p.children[idx + 1] : -1);
+    // now 是 p 的第 idx 个孩子，尝试从左或右兄弟借一个键
+    bool Borrow(Page &p, int idx, Page &now) {
+        int left = (idx > 0 ? p->children()[idx - 1] : -1),
+            right = (idx < p->keycount ? p->children()[idx + 1] : -1);
         if (left != -1) {
-            Node ls = ReadNode(left);
-            if (ls.keycount > kMIN_KEYS) {
-                for (int k = now.keycount; k > 0; k--) {
-                    now.kvs[k] = now.kvs[k - 1];
+            Page ls = FetchNode(left);
+            if (ls->keycount > ls->MinKeys()) {
+                for (int k = now->keycount; k > 0; k--) {
+                    now->Set(k, *now, k - 1);
                 }
-                now.kvs[0] = p.kvs[idx - 1];
-                for (int k = now.keycount + 1; k > 0; k--) {
-                    now.children[k] = now.children[k - 1];
+                if (now->isleaf) {
+                    now->Set(0, *ls, ls->keycount - 1);
+                    p->Set(idx - 1, *now, 0);
+                } else {
+                    now->Set(0, *p, idx - 1);
+                    for (int k = now->keycount + 1; k > 0; k--) {
+                        now->children()[k] = now->children()[k - 1];
+                    }
+                    now->children()[0] = ls->children()[ls->keycount];
+                    p->Set(idx - 1, *ls, ls->keycount - 1);
                 }
-                now.children[0] = ls.children[ls.keycount];
-                now.keycount++;
-                p.kvs[idx - 1] = ls.kvs[ls.keycount - 1];
-                ls.keycount--;
-                WriteNode(left, ls);
-                WriteNode(pos, now);
-                WriteNode(parentpos, p);
-                return;
+                now->keycount++;
+                ls->keycount--;
+                ls.MarkDirty();
+                now.MarkDirty();
+                p.MarkDirty();
+                return true;
             }
         }
         if (right != -1) {
-            Node rs = ReadNode(right);
-            if (rs.keycount > kMIN_KEYS) {
-                now.kvs[now.keycount] = p.kvs[idx];
-                now.children[now.keycount + 1] = rs.children[0];
-                now.keycount++;
-                p.kvs[idx] = rs.kvs[0];
-                for (int k = 0; k < rs.keycount - 1; k++) {
-                    rs.kvs[k] = rs.kvs[k + 1];
-                    rs.children[k] = rs.children[k + 1];
+            Page rs = FetchNode(right);
+            if (rs->keycount > rs->MinKeys()) {
+                if (now->isleaf) {
+                    now->Set(now->keycount, *rs, 0);
+                    for (int k = 0; k < rs->keycount - 1; k++) {
+                        rs->Set(k, *rs, k + 1);
+                    }
+                    p->Set(idx, *rs, 0);
+                } else {
+                    now->Set(now->keycount, *p, idx);
+                    now->children()[now->keycount + 1] = rs->children()[0];
+                    p->Set(idx, *rs, 0);
+                    for (int k = 0; k < rs->keycount - 1; k++) {
+                        rs->Set(k, *rs, k + 1);
+                        rs->children()[k] = rs->children()[k + 1];
+                    }
+                    rs->children()[rs->keycount - 1] = rs->children()[rs->keycount];
                 }
-                rs.children[rs.keycount - 1] = rs.children[rs.keycount];
-                rs.keycount--;
-                WriteNode(right, rs);
-                WriteNode(pos, now);
-                WriteNode(parentpos, p);
-                return;
+                now->keycount++;
+                rs->keycount--;
+                rs.MarkDirty();
+                now.MarkDirty();
+                p.MarkDirty();
+                return true;
             }
         }
-        if (left != -1) {
-            MergeNode(parentpos, idx - 1, idx);
-        } else if (right != -1) { 
-            MergeNode(parentpos, idx, idx);
-        }
+        return false;
     }
 
-    void MergeNode(int parentpos, int idx, int need_del) {
-        Node p = ReadNode(parentpos);
-        if (p.keycount <= 0) return;
-        int left = p.children[idx], right = p.children[idx + 1];
-        Node ls = ReadNode(left), rs = ReadNode(right);
-        if (ls.isleaf) {
-            for (int k = 0; k < rs.keycount; k++) {
-                ls.kvs[ls.keycount + k] = rs.kvs[k];
-            }
-            ls.keycount += rs.keycount;
-            ls.next = rs.next;
-        } else {
-            ls.kvs[ls.keycount] = p.kvs[idx];
-            ls.keycount++;
-            for (int k = 0; k < rs.keycount; k++) {
-                ls.kvs[ls.keycount + k] = rs.kvs[k];
-            }
-            for (int k = 0; k <= rs.keycount; k++) {
-                ls.children[ls.keycount + k] = rs.children[k];
+    // 把 p 的第 idx + 1 个孩子并入第 idx 个孩子，并回收右边的节点
+    void MergeChildren(Page &p, int idx) {
+        merges.Add();
+        int left = p->children()[idx], right = p->children()[idx + 1];
+        {
+            Page ls = FetchNode(left), rs = FetchNode(right);
+            if (ls->isleaf) {
+                for (int k = 0; k < rs->keycount; k++) {
+                    ls->Set(ls->keycount + k, *rs, k);
+                }
+                ls->keycount += rs->keycount;
+                ls->next = rs->next;
+            } else {
+                ls->Set(ls->keycount, *p, idx);
+                ls->keycount++;
+                for (int k = 0; k < rs->keycount; k++) {
+                    ls->Set(ls->keycount + k, *rs, k);
+                }
+                for (int k = 0; k <= rs->keycount; k++) {
+                    ls->children()[ls->keycount + k] = rs->children()[k];
+                }
+                ls->keycount += rs->keycount;
             }
-            ls.keycount += rs.keycount;
+            ls.MarkDirty();
         }
-        WriteNode(left, ls);
-        for (int k = idx; k < p.keycount - 1; k++) {
-            p.kvs[k] = p.kvs[k + 1];
+        for (int k = idx; k < p->keycount - 1; k++) {
+            p->Set(k, *p, k + 1);
         }
-        for (int k = idx + 1; k < p.keycount; k++) {
-            p.children[k] = p.children[k + 1];
+        for (int k = idx + 1; k < p->keycount; k++) {
+            p->children()[k] = p->children()[k + 1];
         }
-        p.keycount--;
-        WriteNode(parentpos, p);
-        if (parentpos == rootpos && !p.keycount) {
-            rootpos = left;
-            return;
+        p->keycount--;
+        p.MarkDirty();
+        FreeNode(right);
+    }
+
+    // 叶子层上的游标，指向一个 (键, 值)，可以前后移动。
+    // 游标记录从根下来的路径，跨叶子时沿路径找相邻的叶子；当前叶子一直 pin 着。
+    // 游标存活期间不能修改这棵树。
+    // 游标一直持有 treelatch 的共享闩，当前叶子上持有页闩（exclusive 时为写闩，用于原地修改值）。
+    class Cursor {
+    private:
+        friend class BPlusTree;
+        BPlusTree *tree = nullptr;
+        sjtu::LatchGuard shared;
+        Path path;
+        Page leaf;
+        int idx = -1;
+        bool exclusive = false;
+#ifdef SJTU_HAS_POSIX
+        int aheadparent = -1, ahead = -1;  // 已经预读到父节点 aheadparent 的第 ahead 个孩子
+#endif
+
+        void Fetch() {
+            leaf = tree->FetchNode(path.pos[path.depth]);
+            LockLeaf();
         }
-        if (parentpos != rootpos && p.keycount < kMIN_KEYS) {
-            auto [gp, gidx] = FindParent(rootpos, parentpos);
-            RebalanceInternal(gp, gidx, ReadNode(gp), p);
+        void LockLeaf() {
+            if (exclusive) {
+                leaf.Lock();
+            } else {
+                leaf.LockShared();
+            }
         }
-    }
 
-    pair<int, int> FindParent(int current, int childPos) {
-        Node node = ReadNode(current);
-        if (node.isleaf) {
-            return {-1, -1};
+        // 从根按 key 下降；upper 为 true 时走最后一个键不大于 key 的子树，否则走第一个可能不小于 key 的子树。
+        // UniqueKey 的分隔键就是右子树中最小的键，两种情况都按 upper 走
+        void Walk(const TKey &key, bool upper) {
+            tree->descents.Add();
+            path.depth = 0;
+            path.pos[0] = tree->rootpos;
+            path.idx[0] = -1;
+            while (true) {
+                Page node = tree->FetchNode(path.pos[path.depth]);
+                if (node->isleaf) {
+                    leaf = std::move(node);
+                    break;
+                }
+                int i = upper || kUNIQUE ? KeyUpperBound(*node, key) : KeyLowerBound(*node, key);
+                path.depth++;
+                path.pos[path.depth] = node->children()[i];
+                path.idx[path.depth] = i;
+            }
+            LockLeaf();
         }
-        for (int i = 0; i <= node.keycount; i++) {
-            if (node.children[i] == childPos) {
-                return {current, i};
+        // 换到左（dir = -1）或右（dir = 1）边相邻的叶子，没有则游标失效
+        bool Step(int dir) {
+            leaf.Release();
+            int d = path.depth;
+            for (; d > 0; d--) {
+                Page parent = tree->FetchNode(path.pos[d - 1]);
+                int i = path.idx[d] + dir;
+                if (i >= 0 && i <= parent->keycount) {
+                    path.idx[d] = i;
+                    path.pos[d] = parent->children()[i];
+                    break;
+                }
+            }
+            if (d == 0) {
+                idx = -1;
+                return false;
             }
-            auto p = FindParent(node.children[i], childPos);
-            if (p.first != -1) {
-                return p;
+            for (; d < path.depth; d++) {
+                Page node = tree->FetchNode(path.pos[d]);
+                int i = dir > 0 ? 0 : node->keycount;
+                path.pos[d + 1] = node->children()[i];
+                path.idx[d + 1] = i;
             }
+            Fetch();
+#ifdef SJTU_HAS_POSIX
+            ReadAhead(dir);
+#endif
+            return true;
         }
-        return {-1, -1};
-    }
+#ifdef SJTU_HAS_POSIX
+        // 长扫描跨过叶子后，预读同一父节点下沿 dir 方向的后 kREADAHEAD 个叶子，
+        // 已经预读过的不再重复。只是提示内核，fstream 下没有效果，所以只在有 POSIX 接口时编译
+        void ReadAhead(int dir) {
+            int parentpos = path.pos[path.depth - 1], i = path.idx[path.depth];
+            Page parent = tree->FetchNode(parentpos);
+            int from = i + dir, to = i + dir * kREADAHEAD;
+            if (to < 0) {
+                to = 0;
+            }
+            if (to > parent->keycount) {
+                to = parent->keycount;
+            }
+            if (aheadparent == parentpos && (ahead - i) * dir > 0) {
+                from = ahead + dir;
+            }
+            for (int j = from; (to - j) * dir >= 0; j += dir) {
+                tree->pool.Prefetch(parent->children()[j]);
+            }
+            aheadparent = parentpos;
+            ahead = to;
+        }
+#endif
 
-    vector<TValue> Find(const TKey &key) {
-        int pos = FindLeaf(rootpos, key);
-        vector<TValue> ans;
-        while (1) {
-            if (pos == -1) {
-                break;
+    public:
+        Cursor() = default;
+        Cursor(BPlusTree *tree, bool exclusive) : tree(tree), shared(tree->treelatch, false), exclusive(exclusive) {}
+
+        bool Valid() const { return leaf && idx >= 0 && idx < leaf->keycount; }
+        TKey &Key() const { return leaf->keys()[idx]; }
+        TValue &Value() const { return leaf->vals()[idx]; }
+        void Next() {
+            if (!leaf) {
+                return;
             }
-            Node node = ReadNode(pos);
-            if (node.keycount == 0 || node.kvs[0].first > key) {
-                break;
+            idx++;
+            while (idx >= leaf->keycount) {
+                if (!Step(1)) {
+                    return;
+                }
+                idx = 0;
+            }
+        }
+        void Prev() {
+            if (!leaf) {
+                return;
             }
-            bool first = true;
-            for (int i = 0; i < node.keycount; i++) {
-                if (node.kvs[i].first == key) {
-                    ans.push_back(node.kvs[i].second);
+            idx--;
+            while (idx < 0) {
+                if (!Step(-1)) {
+                    return;
                 }
+                idx = leaf->keycount - 1;
             }
-            pos = node.next;
         }
-        return ans;
+    };
+
+    // 第一个键不小于 key 的位置；exclusive 为真时叶子加写闩，可以原地修改值
+    Cursor Seek(const TKey &key, bool exclusive = false) {
+        Cursor it(this, exclusive);
+        it.Walk(key, false);
+        it.idx = KeyLowerBound(*it.leaf, key) - 1;
+        it.Next();
+        return it;
     }
-    int FindLeaf(int pos, const TKey &key) {
-        Node node = ReadNode(pos);
-        if (node.isleaf) {
-            return pos;
-        }
-        int i = 0;
-        while (i < node.keycount && node.kvs[i].first < key) {
-            i++;
+    // 最后一个键不大于 key 的位置
+    Cursor SeekLast(const TKey &key) {
+        Cursor it(this, false);
+        it.Walk(key, true);
+        it.idx = KeyUpperBound(*it.leaf, key);
+        it.Prev();
+        return it;
+    }
+
+    bool Contains(const TKey &key) {
+        if (Absent(key)) {
+            return false;
         }
-        return FindLeaf(node.children[i], key);
+        auto it = Seek(key);
+        return it.Valid() && it.Key() == key;
     }
 
-    Node ReadNode(int pos) {
-        int minuse = INT_MAX;
-        int p = -1;
-        for (int i = 0; i < kCACHESIZE; i++) {
-            if (cache[i].used && cache[i].pos == pos) {
-                cache[i].lstuse = usecnt++;
-                return cache[i].node;
-            }
-            if (!cache[i].used) {
-                p = i;
-                break;
-            }
-            if (cache[i].lstuse < minuse) {
-                minuse = cache[i].lstuse;
-                p = i;
-            }
+    vector<TValue> Find(const TKey &key) {
+        vector<TValue> ans;
+        if (Absent(key)) {
+            return ans;
         }
-        Node node;
-        file.read(node, pos);
-        if (p != -1) {
-            cache[p].used = 1;
-            cache[p].pos = pos;
-            cache[p].node = node;
-            cache[p].lstuse = usecnt++;
+        for (auto it = Seek(key); it.Valid() && it.Key() == key; it.Next()) {
+            ans.push_back(it.Value());
         }
-        return node;
+        return ans;
     }
-    void WriteNode(int pos, Node &node) {
-        int p = -1;
-        for (int i = 0; i < kCACHESIZE; i++) {
-            if (cache[i].used && cache[i].pos == pos) {
-                p = i;
-                break;
-            }
+
+    // 内部节点标为热页，长扫描之后仍留在缓存里
+    Page FetchNode(int pos) {
+        Page node = pool.Pin(pos);
+        if (!node->isleaf) {
+            node.MarkHot();
         }
-        if (p != -1) {
-            cache[p].used = 1;
-            cache[p].pos = pos;
-            cache[p].node = node;
-            cache[p].lstuse = usecnt++;
+        return node;
+    }
+    // 分配一个新节点并 pin 住，位置写入 pos
+    Page NewNode(int &pos, bool leaf) {
+        pos = file.alloc();
+        Page node = pool.PinNew(pos);
+        node->isleaf = leaf;
+        node->keycount = 0;
+        node->next = -1;
+        if (!leaf) {
+            node.MarkHot();
         }
-        file.update(node, pos);
+        return node;
+    }
+
+    // 回收节点：丢掉缓存帧，位置交给 MemoryRiver 的空闲链表
+    void FreeNode(int pos) {
+        pool.Discard(pos);
+        file.Delete(pos);
     }
-    int AddNode(Node &p) { return file.write(p); }
 
     vector<TValue> Allvalues() {
+        sjtu::LatchGuard shared(treelatch, false);
         vector<TValue> ans;
         int pos = rootpos;
-        Node node = ReadNode(pos);
-        while (!node.isleaf) {
-            pos = node.children[0];
-            node = ReadNode(pos);
+        while (true) {
+            Page node = FetchNode(pos);
+            if (node->isleaf) {
+                break;
+            }
+            pos = node->children()[0];
         }
         while (pos >= 0) {
-            node = ReadNode(pos);
-            for (int i = 0; i < node.keycount; i++) {
-                ans.push_back(node.kvs[i].second);
+            Page node = FetchNode(pos);
+            node.LockShared();
+            for (int i = 0; i < node->keycount; i++) {
+                ans.push_back(node->vals()[i]);
             }
-            pos = node.next;
+            pos = node->next;
         }
         return ans;
     }
@@ -512,4 +1109,7 @@ public:
     // }
 };
 
+template <class TKey, class TValue, int kPLUS = 4, int kCACHEBYTES = 1 << 20, int kBLOOMBYTES = 0>
+using BPlusMap = BPlusTree<TKey, TValue, kPLUS, kCACHEBYTES, UniqueKey, kBLOOMBYTES>;
+
 #endif // BPT_HPP
\ No newline at end of file
@@ -0,0 +1,755 @@
+#pragma once
+#ifndef BUFFERPOOL_HPP
+#define BUFFERPOOL_HPP
+
+#include "latch.hpp"
+#include "mystl.hpp"
+
+#ifndef SJTU_CACHE_BYTES
+#define SJTU_CACHE_BYTES (8 << 20)
+#endif
+
+namespace sjtu {
+
+// 缓存池与页类型无关的部分，供 CacheGovernor 调用
+class CachePool {
+public:
+    virtual long long PageBytes() const = 0;
+    virtual void SetLimit(int frames) = 0;
+    // 上次调用以来的缺页数，以及其中落在幽灵环里的次数
+    virtual void TakeMisses(long long &misses, long long &ghosthits) = 0;
+
+protected:
+    ~CachePool() = default;
+};
+
+// 所有缓存池和表空间的暂存区、日志缓冲、布隆过滤器共用一份内存预算 SJTU_CACHE_BYTES
+// （启动时可以用 SetBudget 改）。后三者大小固定，用 Reserve 先从预算里扣掉；
+// 剩下的每个池保底 kMIN_FRAMES 帧（不够分时减半，最少 kPIN_FRAMES 帧），其余按需求分：
+// 需求是最近缺页读进来的字节数，幽灵环命中（多给一点内存就能命中的缺页）算两次；
+// 每 kREBALANCE_COMMANDS 条命令衰减一半再累加一次。新建的池以构造时给的字节数作为初始需求。
+// 所以这几部分合起来不超过 max(预算, 预留 + 每个池 kPIN_FRAMES 帧)，只有一次操作
+// 同时 pin 住的页多于上限时会暂时超出；暂存区写满时挪进日志，不会超出份额。
+class CacheGovernor {
+public:
+    static constexpr int kMIN_FRAMES = 16;
+    static constexpr int kPIN_FRAMES = 4;  // 一次操作同时 pin 住的页不超过这个数
+
+private:
+    static constexpr int kREBALANCE_COMMANDS = 256;
+
+    struct Member {
+        CachePool *pool;
+        double demand;
+    };
+    vector<Member> members;
+    long long budget = SJTU_CACHE_BYTES;
+    long long reserved = 0;
+    int ticks = 0;
+
+public:
+    static CacheGovernor &Instance() {
+        static CacheGovernor governor;
+        return governor;
+    }
+
+    long long Budget() const { return budget; }
+    void SetBudget(long long bytes) {
+        budget = bytes;
+        Rebalance();
+    }
+
+    // 缓存池以外固定占用的内存，bytes 为负时归还
+    void Reserve(long long bytes) {
+        reserved += bytes;
+        Rebalance();
+    }
+
+    void Attach(CachePool *pool, long long hint) {
+        members.push_back({pool, static_cast<double>(hint)});
+        Rebalance();
+    }
+    void Detach(CachePool *pool) {
+        for (int i = 0; i < members.size(); i++) {
+            if (members[i].pool == pool) {
+                members[i] = members[members.size() - 1];
+                members.pop_back();
+                return;
+            }
+        }
+    }
+
+    // 每条命令执行完调用一次
+    void Tick() {
+        if (++ticks < kREBALANCE_COMMANDS) {
+            return;
+        }
+        ticks = 0;
+        for (int i = 0; i < members.size(); i++) {
+            long long misses, ghosthits;
+            members[i].pool->TakeMisses(misses, ghosthits);
+            members[i].demand = members[i].demand / 2 + static_cast<double>(misses + ghosthits) * members[i].pool->PageBytes();
+        }
+        Rebalance();
+    }
+
+    void Rebalance() {
+        long long spare = budget - reserved, pages = 0;
+        double total = 0;
+        for (int i = 0; i < members.size(); i++) {
+            pages += members[i].pool->PageBytes();
+            total += members[i].demand;
+        }
+        int floor = kMIN_FRAMES;
+        while (floor > kPIN_FRAMES && floor * pages > spare) {
+            floor /= 2;
+        }
+        spare -= floor * pages;
+        if (spare < 0) {
+            spare = 0;
+        }
+        for (int i = 0; i < members.size(); i++) {
+            double part = total > 0 ? members[i].demand / total : 1.0 / members.size();
+            long long bytes = static_cast<long long>(spare * part);
+            members[i].pool->SetLimit(floor + static_cast<int>(bytes / members[i].pool->PageBytes()));
+        }
+    }
+};
+
+// 写回式页缓存。帧按页号分片，每个分片有自己的哈希表和淘汰队列，脏页只在淘汰或 Flush 时写回。
+// 淘汰用 2Q：新页进试用队列（kIN），再次访问或刚从试用队列淘汰过（还在幽灵环里）时进主队列（kMAIN）；
+// 试用队列超过份额时先淘汰它，一遍扫描不会冲掉主队列。热页（B+ 树内部节点）不超过分片一半时不淘汰。
+// 页内存在帧第一次装入时才分配，常驻页数不超过 CacheGovernor 给的上限，缩小时淘汰并释放。
+// 页通过 Handle 原地访问，被 pin 住的帧不会被淘汰。SJTU_CONCURRENT 下每个分片一把锁，每帧一把读写锁。
+template <class T, class Store> class BufferPool : public CachePool {
+public:
+    class Handle;
+
+private:
+    static constexpr int kMAX_SHARDS = 4;
+    static constexpr int kPIN_FRAMES = CacheGovernor::kPIN_FRAMES;
+    static constexpr int kFRAMES_PER_SHARD = 32;
+
+    static constexpr int kIN = 0, kMAIN = 1;
+
+    struct Frame {
+        T *page = nullptr;
+        int pos = -1;
+        int pins = 0;
+        bool dirty = false;
+        bool hot = false;
+        char queue = kIN;
+        int hnext = -1;            // 同一个哈希桶里的下一帧
+        int prev = -1, next = -1;  // 所在淘汰队列，队头最新
+        Latch latch;               // 保护页内容
+    };
+    struct Shard {
+        int begin = 0, end = 0;  // 分片的帧 [begin, end)
+        int used = 0;          // [begin, begin + used) 已经用过
+        int freehead = -1;     // 缩小时释放了页内存的帧，用 next 串起来
+        int limit = 0, resident = 0;
+        int head[2] = {-1, -1}, tail[2] = {-1, -1};
+        int count[2] = {0, 0};
+        int hotquota = 1, hotcnt = 0;
+        int mask = 0;
+        int *buckets = nullptr;
+        int *ghosts = nullptr;  // 最近从试用队列淘汰的页号
+        int ghostcap = 1, ghostlen = 1, ghostnext = 0;
+        int *ghostset = nullptr;  // 开放寻址表，存幽灵环里有页号的槽位，按页号查找
+        int ghostmask = 0;
+        long long misses = 0, ghosthits = 0;  // 上次交给 CacheGovernor 以来的
+        long long hitcnt = 0, misscnt = 0, writecnt = 0, promotecnt = 0;
+        Latch latch;  // 保护哈希表、队列和 pin 计数
+    };
+
+    Store *store;
+    int framecnt;  // 帧数，即份额的上限
+    int shardcnt;
+    int limit = 0;
+    Frame *frames;
+    Shard shards[kMAX_SHARDS];
+
+    Shard &ShardOf(int pos) { return shards[pos % shardcnt]; }
+    Shard &ShardOfFrame(int f) {
+        int i = f / (framecnt / shardcnt);
+        return shards[i < shardcnt ? i : shardcnt - 1];
+    }
+    static int Bucket(const Shard &s, int pos) {
+        return static_cast<int>((static_cast<unsigned>(pos) * 2654435761u) >> 7) & s.mask;
+    }
+
+    int Lookup(Shard &s, int pos) {
+        for (int f = s.buckets[Bucket(s, pos)]; f != -1; f = frames[f].hnext) {
+            if (frames[f].pos == pos) {
+                return f;
+            }
+        }
+        return -1;
+    }
+    void Unlink(Shard &s, int f) {
+        int q = frames[f].queue;
+        if (frames[f].prev != -1) {
+            frames[frames[f].prev].next = frames[f].next;
+        } else {
+            s.head[q] = frames[f].next;
+        }
+        if (frames[f].next != -1) {
+            frames[frames[f].next].prev = frames[f].prev;
+        } else {
+            s.tail[q] = frames[f].prev;
+        }
+        frames[f].prev = frames[f].next = -1;
+        s.count[q]--;
+    }
+    void PushFront(Shard &s, int f, int q) {
+        frames[f].queue = q;
+        frames[f].prev = -1;
+        frames[f].next = s.head[q];
+        if (s.head[q] != -1) {
+            frames[s.head[q]].prev = f;
+        }
+        s.head[q] = f;
+        if (s.tail[q] == -1) {
+            s.tail[q] = f;
+        }
+        s.count[q]++;
+    }
+    void PushBack(Shard &s, int f, int q) {
+        frames[f].queue = q;
+        frames[f].next = -1;
+        frames[f].prev = s.tail[q];
+        if (s.tail[q] != -1) {
+            frames[s.tail[q]].next = f;
+        }
+        s.tail[q] = f;
+        if (s.head[q] == -1) {
+            s.head[q] = f;
+        }
+        s.count[q]++;
+    }
+    // 再次访问：移到主队列头。同一次操作里别重复 pin 同一页，否则试用队列里的页会被直接提升
+    void Touch(Shard &s, int f) {
+        if (frames[f].queue == kMAIN && s.head[kMAIN] == f) {
+            return;
+        }
+        if (frames[f].queue == kIN) {
+            s.promotecnt++;
+        }
+        Unlink(s, f);
+        PushFront(s, f, kMAIN);
+    }
+    static int GhostBucket(const Shard &s, int pos) {
+        return static_cast<int>((static_cast<unsigned>(pos) * 2654435761u) >> 7) & s.ghostmask;
+    }
+    // 幽灵环里页号为 pos 的槽位在 ghostset 中的位置，slot 不为 -1 时还要求槽位就是它；没有返回 -1
+    int GhostFind(Shard &s, int pos, int slot = -1) {
+        for (int h = GhostBucket(s, pos); s.ghostset[h] != -1; h = (h + 1) & s.ghostmask) {
+            int g = s.ghostset[h];
+            if (s.ghosts[g] == pos && (slot == -1 || g == slot)) {
+                return h;
+            }
+        }
+        return -1;
+    }
+    // 清空槽位 g，后面同一串里的项往前挪
+    void GhostClear(Shard &s, int g) {
+        int h = GhostFind(s, s.ghosts[g], g);
+        s.ghostset[h] = -1;
+        for (int j = (h + 1) & s.ghostmask; s.ghostset[j] != -1; j = (j + 1) & s.ghostmask) {
+            int home = GhostBucket(s, s.ghosts[s.ghostset[j]]);
+            if (((j - home) & s.ghostmask) >= ((j - h) & s.ghostmask)) {
+                s.ghostset[h] = s.ghostset[j];
+                s.ghostset[j] = -1;
+                h = j;
+            }
+        }
+        s.ghosts[g] = -1;
+    }
+    void PushGhost(Shard &s, int pos) {
+        int g = s.ghostnext;
+        if (s.ghosts[g] != -1) {
+            GhostClear(s, g);
+        }
+        s.ghosts[g] = pos;
+        int h = GhostBucket(s, pos);
+        while (s.ghostset[h] != -1) {
+            h = (h + 1) & s.ghostmask;
+        }
+        s.ghostset[h] = g;
+        s.ghostnext = (g + 1) % s.ghostlen;
+    }
+    // pos 在幽灵环里就移除并返回 true
+    bool TakeGhost(Shard &s, int pos) {
+        int h = GhostFind(s, pos);
+        if (h == -1) {
+            return false;
+        }
+        GhostClear(s, s.ghostset[h]);
+        return true;
+    }
+    void SetHot(Shard &s, int f, bool hot) {
+        if (frames[f].hot != hot) {
+            frames[f].hot = hot;
+            s.hotcnt += hot ? 1 : -1;
+        }
+    }
+    void HashErase(Shard &s, int f) {
+        int *p = &s.buckets[Bucket(s, frames[f].pos)];
+        while (*p != f) {
+            p = &frames[*p].hnext;
+        }
+        *p = frames[f].hnext;
+        frames[f].hnext = -1;
+    }
+    void HashInsert(Shard &s, int f) {
+        int b = Bucket(s, frames[f].pos);
+        frames[f].hnext = s.buckets[b];
+        s.buckets[b] = f;
+    }
+
+    // 从队列 q 的尾部找一个没被 pin 的帧；keephot 时跳过受保护的热页
+    int Pick(Shard &s, int q, bool keephot) {
+        for (int f = s.tail[q]; f != -1; f = frames[f].prev) {
+            if (!frames[f].pins && (!keephot || !frames[f].hot || s.hotcnt > s.hotquota)) {
+                return f;
+            }
+        }
+        return -1;
+    }
+    // 按 2Q 选一个可以淘汰的帧，全都被 pin 住时返回 -1
+    int Choose(Shard &s) {
+        int f = -1;
+        if (s.tail[kIN] != -1 && frames[s.tail[kIN]].pos == -1 && !frames[s.tail[kIN]].pins) {
+            f = s.tail[kIN];
+        }
+        if (f == -1 && s.count[kIN] > s.limit / 4) {
+            f = Pick(s, kIN, true);
+        }
+        if (f == -1) {
+            f = Pick(s, kMAIN, true);
+        }
+        if (f == -1) {
+            f = Pick(s, kIN, false);
+        }
+        if (f == -1) {
+            f = Pick(s, kMAIN, false);
+        }
+        return f;
+    }
+    // 把帧移出哈希表和队列，脏页先写回
+    void Evict(Shard &s, int f) {
+        if (frames[f].pos != -1) {
+            if (frames[f].dirty) {
+                store->update(*frames[f].page, frames[f].pos);
+                s.writecnt++;
+            }
+            if (frames[f].queue == kIN) {
+                PushGhost(s, frames[f].pos);
+            }
+            HashErase(s, f);
+            frames[f].pos = -1;
+        }
+        frames[f].dirty = false;
+        SetHot(s, f, false);
+        Unlink(s, f);
+    }
+    // 取一个没有页内存的帧并分配，没有时返回 -1
+    int Fresh(Shard &s) {
+        int f;
+        if (s.freehead != -1) {
+            f = s.freehead;
+            s.freehead = frames[f].next;
+            frames[f].next = -1;
+        } else if (s.begin + s.used < s.end) {
+            f = s.begin + s.used++;
+        } else {
+            return -1;
+        }
+        frames[f].page = new T;
+        s.resident++;
+        return f;
+    }
+    // 取一个可用的帧：不到上限时分配新页，否则淘汰一个；全都被 pin 住时暂时超过上限
+    int Victim(Shard &s) {
+        int f = s.resident < s.limit ? Fresh(s) : -1;
+        if (f != -1) {
+            return f;
+        }
+        f = Choose(s);
+        if (f != -1) {
+            Evict(s, f);
+            return f;
+        }
+        f = Fresh(s);
+        if (f == -1) {
+            throw runtime_error();
+        }
+        return f;
+    }
+    // 淘汰到不超过上限，并释放页内存
+    void Trim(Shard &s) {
+        while (s.resident > s.limit) {
+            int f = Choose(s);
+            if (f == -1) {
+                return;
+            }
+            Evict(s, f);
+            delete frames[f].page;
+            frames[f].page = nullptr;
+            frames[f].next = s.freehead;
+            s.freehead = f;
+            s.resident--;
+        }
+    }
+    int Install(Shard &s, int pos) {
+        int f = Victim(s);
+        frames[f].pos = pos;
+        HashInsert(s, f);
+        PushFront(s, f, TakeGhost(s, pos) ? kMAIN : kIN);
+        return f;
+    }
+
+public:
+    // bytes 是初始份额，也决定分片数；份额最多能涨到整个预算
+    BufferPool(Store *store, long long bytes) : store(store) {
+        int hint = static_cast<int>(bytes / static_cast<long long>(sizeof(T)));
+        framecnt = static_cast<int>(CacheGovernor::Instance().Budget() / static_cast<long long>(sizeof(T)));
+        if (framecnt < hint) {
+            framecnt = hint;
+        }
+        // 帧本身很小，页内存按上限分配；多留些帧给全被 pin 住时临时超出上限用
+        if (framecnt < CacheGovernor::kMIN_FRAMES) {
+            framecnt = CacheGovernor::kMIN_FRAMES;
+        }
+        shardcnt = hint / kFRAMES_PER_SHARD;
+        if (shardcnt < 1) {
+            shardcnt = 1;
+        }
+        if (shardcnt > kMAX_SHARDS) {
+            shardcnt = kMAX_SHARDS;
+        }
+        frames = new Frame[framecnt];
+        for (int i = 0; i < shardcnt; i++) {
+            Shard &s = shards[i];
+            s.begin = framecnt / shardcnt * i;
+            s.end = (i + 1 == shardcnt ? framecnt : framecnt / shardcnt * (i + 1));
+            int cap = 1;
+            while (cap < 2 * (s.end - s.begin)) {
+                cap <<= 1;
+            }
+            s.mask = cap - 1;
+            s.buckets = new int[cap];
+            for (int b = 0; b < cap; b++) {
+                s.buckets[b] = -1;
+            }
+            int n = s.end - s.begin;
+            s.ghostcap = n / 2 > 1 ? n / 2 : 1;
+            s.ghosts = new int[s.ghostcap];
+            for (int g = 0; g < s.ghostcap; g++) {
+                s.ghosts[g] = -1;
+            }
+            cap = 1;
+            while (cap < 2 * s.ghostcap) {
+                cap <<= 1;
+            }
+            s.ghostmask = cap - 1;
+            s.ghostset = new int[cap];
+            for (int h = 0; h < cap; h++) {
+                s.ghostset[h] = -1;
+            }
+        }
+        SetLimit(hint);
+        CacheGovernor::Instance().Attach(this, bytes);
+    }
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+    ~BufferPool() {
+        CacheGovernor::Instance().Detach(this);
+        for (int i = 0; i < shardcnt; i++) {
+            delete[] shards[i].buckets;
+            delete[] shards[i].ghosts;
+            delete[] shards[i].ghostset;
+        }
+        for (int f = 0; f < framecnt; f++) {
+            delete frames[f].page;
+        }
+        delete[] frames;
+    }
+
+    // pin 住一帧。改了页要调用 MarkDirty 才会写回；通过它加的锁随 pin 一起释放
+    class Handle {
+    private:
+        BufferPool *pool = nullptr;
+        int f = -1;
+        char latched = 0;  // 0: none, 1: shared, 2: exclusive
+
+    public:
+        Handle() = default;
+        Handle(BufferPool *pool, int f) : pool(pool), f(f) {}
+        Handle(const Handle &) = delete;
+        Handle &operator=(const Handle &) = delete;
+        Handle(Handle &&other) noexcept : pool(other.pool), f(other.f), latched(other.latched) {
+            other.pool = nullptr;
+            other.latched = 0;
+        }
+        Handle &operator=(Handle &&other) noexcept {
+            if (this != &other) {
+                Release();
+                pool = other.pool, f = other.f, latched = other.latched;
+                other.pool = nullptr;
+                other.latched = 0;
+            }
+            return *this;
+        }
+        ~Handle() { Release(); }
+
+        T *operator->() const { return pool->frames[f].page; }
+        T &operator*() const { return *pool->frames[f].page; }
+        explicit operator bool() const { return pool != nullptr; }
+        int pos() const { return pool->frames[f].pos; }
+        void MarkDirty() { pool->frames[f].dirty = true; }
+        // 标为热页（如 B+ 树的内部节点），淘汰时尽量保留
+        void MarkHot() {
+            if (pool->frames[f].hot) {
+                return;
+            }
+            Shard &s = pool->ShardOfFrame(f);
+            LatchGuard guard(s.latch, true);
+            pool->SetHot(s, f, true);
+        }
+        void LockShared() {
+            pool->frames[f].latch.LockShared();
+            latched = 1;
+        }
+        void Lock() {
+            pool->frames[f].latch.Lock();
+            latched = 2;
+        }
+        // 放掉页闩，保留 pin
+        void Unlock() {
+            if (latched == 1) {
+                pool->frames[f].latch.UnlockShared();
+            } else if (latched == 2) {
+                pool->frames[f].latch.Unlock();
+            }
+            latched = 0;
+        }
+        void Release() {
+            if (!pool) {
+                return;
+            }
+            Unlock();
+            Shard &s = pool->ShardOfFrame(f);
+            s.latch.Lock();
+            pool->frames[f].pins--;
+            s.latch.Unlock();
+            pool = nullptr;
+        }
+    };
+
+    int Capacity() const { return framecnt; }
+    int Limit() const { return limit; }
+
+    long long PageBytes() const override { return sizeof(T); }
+    // 常驻页数的上限，平分到各分片；缩小时立即淘汰多出来的页
+    void SetLimit(int frames) override {
+        if (frames < kPIN_FRAMES) {
+            frames = kPIN_FRAMES;
+        }
+        if (frames > framecnt) {
+            frames = framecnt;
+        }
+        limit = frames;
+        for (int i = 0; i < shardcnt; i++) {
+            Shard &s = shards[i];
+            LatchGuard guard(s.latch, true);
+            s.limit = frames / shardcnt + (i < frames % shardcnt ? 1 : 0);
+            if (s.limit > s.end - s.begin) {
+                s.limit = s.end - s.begin;
+            }
+            s.hotquota = s.limit / 2 > 1 ? s.limit / 2 : 1;
+            int ghostlen = s.hotquota < s.ghostcap ? s.hotquota : s.ghostcap;
+            for (int g = ghostlen; g < s.ghostlen; g++) {
+                if (s.ghosts[g] != -1) {
+                    GhostClear(s, g);
+                }
+            }
+            s.ghostlen = ghostlen;
+            s.ghostnext %= s.ghostlen;
+            Trim(s);
+        }
+    }
+    void TakeMisses(long long &misses, long long &ghosthits) override {
+        misses = ghosthits = 0;
+        for (int i = 0; i < shardcnt; i++) {
+            Shard &s = shards[i];
+            LatchGuard guard(s.latch, true);
+            misses += s.misses;
+            ghosthits += s.ghosthits;
+            s.misses = s.ghosthits = 0;
+        }
+    }
+
+    Handle Pin(int pos) {
+        Shard &s = ShardOf(pos);
+        LatchGuard guard(s.latch, true);
+        int f = Lookup(s, pos);
+        if (f != -1) {
+            Touch(s, f);
+            s.hitcnt++;
+        } else {
+            f = Install(s, pos);
+            s.misscnt++;
+            s.misses++;
+            if (frames[f].queue == kMAIN) {
+                s.ghosthits++;
+            }
+            store->read(*frames[f].page, pos);
+        }
+        frames[f].pins++;
+        return Handle(this, f);
+    }
+
+    // 启动以来的命中、缺页、写回次数，以及从试用队列提升到主队列的次数
+    void Counters(long long &hits, long long &misses, long long &writes, long long &promotions) {
+        hits = misses = writes = promotions = 0;
+        for (int i = 0; i < shardcnt; i++) {
+            Shard &s = shards[i];
+            LatchGuard guard(s.latch, true);
+            hits += s.hitcnt;
+            misses += s.misscnt;
+            writes += s.writecnt;
+            promotions += s.promotecnt;
+        }
+    }
+
+    // 常驻页的编号写进 out，最多 max 个：先热页，再主队列从新到旧，最后试用队列
+    int Resident(int *out, int max) {
+        int n = 0;
+        for (int pass = 0; pass < 3; pass++) {
+            for (int i = 0; i < shardcnt && n < max; i++) {
+                Shard &s = shards[i];
+                LatchGuard guard(s.latch, true);
+                int q = pass == 2 ? kIN : kMAIN;
+                for (int f = s.head[q]; f != -1 && n < max; f = frames[f].next) {
+                    if (frames[f].pos != -1 && frames[f].hot == (pass == 0)) {
+                        out[n++] = frames[f].pos;
+                    }
+                }
+                if (pass == 0) {
+                    for (int f = s.head[kIN]; f != -1 && n < max; f = frames[f].next) {
+                        if (frames[f].pos != -1 && frames[f].hot) {
+                            out[n++] = frames[f].pos;
+                        }
+                    }
+                }
+            }
+        }
+        return n;
+    }
+
+    // 启动预热：pos 不在缓存中且分片没到上限时读进试用队列，不算缺页。
+    // 到了上限返回 false，不淘汰别的页
+    bool Preload(int pos) {
+        Shard &s = ShardOf(pos);
+        LatchGuard guard(s.latch, true);
+        if (Lookup(s, pos) != -1) {
+            return true;
+        }
+        int f = s.resident < s.limit ? Fresh(s) : -1;
+        if (f == -1) {
+            return false;
+        }
+        frames[f].pos = pos;
+        frames[f].dirty = false;
+        HashInsert(s, f);
+        PushFront(s, f, kIN);
+        store->read(*frames[f].page, pos);
+        return true;
+    }
+
+    // pos 不在缓存中时让存储层预读，不等待也不占用帧
+    void Prefetch(int pos) {
+        Shard &s = ShardOf(pos);
+        LatchGuard guard(s.latch, true);
+        if (Lookup(s, pos) == -1) {
+            store->prefetch(pos);
+        }
+    }
+
+    // pos 是刚分配、尚未写入的页：不读盘，由调用者初始化内容
+    Handle PinNew(int pos) {
+        Shard &s = ShardOf(pos);
+        LatchGuard guard(s.latch, true);
+        int f = Lookup(s, pos);
+        if (f != -1) {
+            Touch(s, f);
+        } else {
+            f = Install(s, pos);
+        }
+        frames[f].pins++;
+        frames[f].dirty = true;
+        return Handle(this, f);
+    }
+
+    void Flush() {
+        for (int i = 0; i < shardcnt; i++) {
+            Shard &s = shards[i];
+            LatchGuard guard(s.latch, true);
+            for (int f = s.begin; f < s.begin + s.used; f++) {
+                if (frames[f].dirty && frames[f].pos != -1) {
+                    store->update(*frames[f].page, frames[f].pos);
+                    frames[f].dirty = false;
+                    s.writecnt++;
+                }
+            }
+        }
+    }
+
+    // 页被释放：丢掉它的帧且不写回。帧若仍被 pin 住，则等 unpin 后再复用
+    void Discard(int pos) {
+        Shard &s = ShardOf(pos);
+        LatchGuard guard(s.latch, true);
+        int f = Lookup(s, pos);
+        if (f == -1) {
+            return;
+        }
+        HashErase(s, f);
+        frames[f].pos = -1;
+        frames[f].dirty = false;
+        SetHot(s, f, false);
+        Unlink(s, f);
+        PushBack(s, f, kIN);
+    }
+
+    // 丢弃所有帧（不写回），用于文件被清空之后
+    void Reset() {
+        for (int i = 0; i < shardcnt; i++) {
+            Shard &s = shards[i];
+            LatchGuard guard(s.latch, true);
+            for (int b = 0; b <= s.mask; b++) {
+                s.buckets[b] = -1;
+            }
+            for (int f = s.begin; f < s.end; f++) {
+                delete frames[f].page;
+                frames[f] = Frame();
+            }
+            for (int g = 0; g < s.ghostcap; g++) {
+                s.ghosts[g] = -1;
+            }
+            for (int h = 0; h <= s.ghostmask; h++) {
+                s.ghostset[h] = -1;
+            }
+            s.used = 0;
+            s.freehead = -1;
+            s.resident = 0;
+            s.head[kIN] = s.head[kMAIN] = s.tail[kIN] = s.tail[kMAIN] = -1;
+            s.count[kIN] = s.count[kMAIN] = 0;
+            s.hotcnt = 0;
+        }
+    }
+};
+
+} // namespace sjtu
+
+#endif // BUFFERPOOL_HPP
@@ -0,0 +1,103 @@
+#pragma once
+#ifndef DICTIONARY_HPP
+#define DICTIONARY_HPP
+
+#include <iostream>
+#include <string>
+#include "bpt.hpp"
+#include "mystl.hpp"
+
+// 字符串到稠密编号（TId）的字典，编号从 0 开始，存放原串的记录下标就是编号；
+// 删掉的编号由之后加入的串优先复用。
+// 用原串的哈希建索引；哈希被别的串占了就顺延到下一个哈希值，查到后与原串核对。
+// 删除时把顺延链上后面的项往前挪，所以链不会断。
+template <int max_size, class TId = short> class Dictionary {
+public:
+    using Name = sjtu::MyString<max_size>;
+    static constexpr long long kMAX_IDS = (1ll << (sizeof(TId) * 8 - 1)) - 1;
+
+private:
+    BPlusMap<ull, TId, 4, 1 << 18, 1 << 14> index;
+    MemoryRiver<Name> names;
+
+    // name 的编号，没有时返回 -1 并把可以用的哈希值写入 key
+    TId Probe(const Name &name, ull &key) {
+        for (key = hash(name);; key++) {
+            auto [id, has] = index.Get(key);
+            if (!has) {
+                return -1;
+            }
+            Name stored;
+            names.read(stored, id);
+            if (stored == name) {
+                return id;
+            }
+        }
+    }
+
+public:
+    explicit Dictionary(const std::string &name) : index(name + "idx") {
+        names.initialise(name + "names", 1);
+    }
+
+    TId Find(const Name &name) {
+        ull key;
+        return Probe(name, key);
+    }
+    // 没有就加入，返回编号；编号用完（且没有删掉的编号可以复用）时抛出异常
+    TId Insert(const Name &name) {
+        ull key;
+        TId id = Probe(name, key);
+        if (id != -1) {
+            return id;
+        }
+        if (names.size() >= kMAX_IDS && !names.has_free()) {
+            throw sjtu::runtime_error();
+        }
+        id = names.write(const_cast<Name &>(name));
+        index.Insert(key, id);
+        return id;
+    }
+    // 删掉 name，回收它的编号；没有时什么也不做
+    void Erase(const Name &name) {
+        ull key;
+        TId id = Probe(name, key);
+        if (id == -1) {
+            return;
+        }
+        index.Remove(key, id);
+        names.Delete(id);
+        for (ull next = key + 1;; next++) {
+            auto [moved, has] = index.Get(next);
+            if (!has) {
+                break;
+            }
+            Name stored;
+            names.read(stored, moved);
+            if (hash(stored) <= key) {
+                index.Remove(next, moved);
+                index.Insert(key, moved);
+                key = next;
+            }
+        }
+    }
+    Name Get(TId id) {
+        Name name;
+        names.read(name, id);
+        return name;
+    }
+    int Size() {
+        return names.size();
+    }
+
+    void Clear() {
+        names.clear();
+        index.Clear();
+    }
+    void Stats(std::ostream &os, bool full) {
+        index.Stats(os, full);
+        names.stats(os);
+    }
+};
+
+#endif // DICTIONARY_HPP
@@ -0,0 +1,112 @@
+#pragma once
+#ifndef LATCH_HPP
+#define LATCH_HPP
+
+namespace sjtu {
+
+// 读写闩：多个读者或一个写者，自旋等待，读者优先（同一线程可以重复加读闩）。
+// 只在定义 SJTU_CONCURRENT 时生效，单线程的默认构建里所有操作都是空的。
+// 用 GCC 的 __atomic 内建函数实现，不依赖额外的头文件。
+class Latch {
+#ifdef SJTU_CONCURRENT
+private:
+    int state = 0;  // > 0 为读者数，-1 为有写者
+
+    static void Pause() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+public:
+    void LockShared() {
+        while (true) {
+            int s = __atomic_load_n(&state, __ATOMIC_RELAXED);
+            if (s >= 0 && __atomic_compare_exchange_n(&state, &s, s + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return;
+            }
+            Pause();
+        }
+    }
+    void UnlockShared() { __atomic_fetch_sub(&state, 1, __ATOMIC_RELEASE); }
+    void Lock() {
+        while (true) {
+            int s = 0;
+            if (__atomic_compare_exchange_n(&state, &s, -1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return;
+            }
+            Pause();
+        }
+    }
+    void Unlock() { __atomic_store_n(&state, 0, __ATOMIC_RELEASE); }
+#else
+public:
+    void LockShared() {}
+    void UnlockShared() {}
+    void Lock() {}
+    void Unlock() {}
+#endif
+};
+
+// 统计用的计数器，SJTU_CONCURRENT 下用原子加
+class Counter {
+private:
+    long long value = 0;
+
+public:
+    void Add(long long n = 1) {
+#ifdef SJTU_CONCURRENT
+        __atomic_fetch_add(&value, n, __ATOMIC_RELAXED);
+#else
+        value += n;
+#endif
+    }
+    long long Get() const { return value; }
+};
+
+// 作用域内持有一个闩，析构或 Release 时放开
+class LatchGuard {
+private:
+    Latch *latch = nullptr;
+    bool exclusive = false;
+
+public:
+    LatchGuard() = default;
+    LatchGuard(Latch &l, bool exclusive) : latch(&l), exclusive(exclusive) {
+        if (exclusive) {
+            latch->Lock();
+        } else {
+            latch->LockShared();
+        }
+    }
+    LatchGuard(const LatchGuard &) = delete;
+    LatchGuard &operator=(const LatchGuard &) = delete;
+    LatchGuard(LatchGuard &&other) noexcept : latch(other.latch), exclusive(other.exclusive) {
+        other.latch = nullptr;
+    }
+    LatchGuard &operator=(LatchGuard &&other) noexcept {
+        if (this != &other) {
+            Release();
+            latch = other.latch, exclusive = other.exclusive;
+            other.latch = nullptr;
+        }
+        return *this;
+    }
+    ~LatchGuard() { Release(); }
+
+    void Release() {
+        if (!latch) {
+            return;
+        }
+        if (exclusive) {
+            latch->Unlock();
+        } else {
+            latch->UnlockShared();
+        }
+        latch = nullptr;
+    }
+};
+
+} // namespace sjtu
+
+#endif // LATCH_HPP
@@ -6,6 +6,12 @@
 #include <fstream>
 #include <string>
 
+// immintrin.h 不在作业允许的头文件里，只在编译时打开 AVX2（-mavx2，cmake 里是 -DSJTU_USE_AVX2=ON）时使用
+#if defined(__GNUC__) && defined(__AVX2__)
+#include <immintrin.h>
+#define SJTU_HAS_AVX2
+#endif
+
 namespace sjtu {
 template <class T1, class T2> class pair {
 public:
@@ -24,22 +30,22 @@ public:
         first = other.first, second = other.second;
         return *this;
     }
-    bool operator<(const pair &other) {
+    bool operator<(const pair &other) const {
         if (first != other.first)
             return first < other.first;
         return second < other.second;
     }
-    bool operator>(const pair &other) {
+    bool operator>(const pair &other) const {
         if (first != other.first)
             return first > other.first;
         return second > other.second;
     }
-    bool operator==(const pair &other) {
+    bool operator==(const pair &other) const {
         return first == other.first && second == other.second;
     }
-    bool operator<=(const pair &other) { return !((*this) > other); }
-    bool operator>=(const pair &other) { return !((*this) < other); }
-    bool operator!=(const pair &other) { return !((*this) == other); }
+    bool operator<=(const pair &other) const { return !((*this) > other); }
+    bool operator>=(const pair &other) const { return !((*this) < other); }
+    bool operator!=(const pair &other) const { return !((*this) == other); }
 };
 class exception {
 protected:
@@ -82,6 +88,7 @@ public:
     const T &operator[](int) const;
     T &back() { return a[size_ - 1]; }
     const T &back() const { return a[size_ - 1]; }
+    const T *data() const { return a; }
     void clear() { size_ = 0; }
     bool empty() const { return size_ == 0; }
 
@@ -666,136 +673,100 @@ private:
     }
 };
 
-template <class T, int info_len = 4> class MemoryRiver {
-private:
-    /* your code here */
-    const int sizeofsize_t = sizeof(int);
-    std::fstream file;
-    std::string file_name;
-    int sizeofT = sizeof(T);
-    int len_{};
-
-public:
-    MemoryRiver() = default;
-
-    MemoryRiver(const std::string &file_name) : file_name(file_name) {}
-
-    ~MemoryRiver() {
-        if (!file.is_open()) {
-            file.open(file_name, std::ios::in | std::ios::out);
-        }
-        int t = len_;
-        write_info(t, 1);
-        file.close();
-    }
-
-    void clear() {
-        len_ = 0;
-        for (int i = 1; i <= info_len; i++) {
-            write_info(0, i);
-        }
-    }
-
-    void initialise(std::string FN = "", bool clear_file = 0) {
-        if (FN != "")
-            file_name = FN;
-        if (clear_file == 0) {
-            file.open(file_name, std::ios::out);
-            int tmp = 0;
-            for (int i = 0; i < info_len; i++)
-                file.write(reinterpret_cast<char *>(&tmp), sizeof(int));
-        } else {
-            file.open(file_name, std::ios::in);
-            if (!file) {
-                file.open(file_name, std::ios::out);
-                int tmp = 0;
-                for (int i = 0; i < info_len; i++)
-                    file.write(reinterpret_cast<char *>(&tmp), sizeof(int));
-            } else {
-                int t;
-                get_info(t, 1);
-                len_ = t;
-            }
-        }
-        file.close();
-    }
-
-    // 读出第n个int的值赋给tmp，1_base
-    void get_info(int &tmp, int n) {
-        if (n > info_len)
-            return;
-        if (!file.is_open()) {
-            file.open(file_name, std::ios::in | std::ios::out);
-        }
-        file.seekg((n - 1) * sizeofsize_t);
-        file.read(reinterpret_cast<char *>(&tmp), sizeofsize_t);
-    }
-
-    // 将tmp写入第n个int的位置，1_base
-    void write_info(int tmp, int n) {
-        if (n > info_len)
-            return;
-        if (!file.is_open()) {
-            file.open(file_name, std::ios::in | std::ios::out);
-        }
-        file.seekp((n - 1) * sizeofsize_t);
-        file.write(reinterpret_cast<char *>(&tmp), sizeofsize_t);
-    }
-
-    // 在文件合适位置写入类对象t，并返回写入的位置索引index
-    // 位置索引意味着当输入正确的位置索引index，在以下三个函数中都能顺利的找到目标对象进行操作
-    // 位置索引index可以取为对象写入的起始位置
-    int write(T &t) {
-        if (!file.is_open()) {
-            file.open(file_name, std::ios::in | std::ios::out);
-        }
-        int pos = info_len * sizeofsize_t + len_ * sizeofT;
-        file.seekp(pos);
-        file.write(reinterpret_cast<char *>(&t), sizeofT);
-        ++len_;
-        return len_ - 1;
+// 有序数组 a[0, n) 上的无分支二分：返回第一个不小于 key 的下标
+template <class T> int lower_bound(const T *a, int n, const T &key) {
+    if (n <= 0) {
+        return 0;
     }
-
-    // 用t的值更新位置索引index对应的对象，保证调用的index都是由write函数产生
-    void update(T &t, const int index) {
-        if (!file.is_open()) {
-            file.open(file_name, std::ios::in | std::ios::out);
-        }
-        int pos = info_len * sizeofsize_t + index * sizeofT;
-        file.seekp(pos);
-        file.write(reinterpret_cast<char *>(&t), sizeofT);
+    const T *base = a;
+    while (n > 1) {
+        int half = n / 2;
+        base = (base[half] < key) ? base + half : base;
+        n -= half;
     }
+    return static_cast<int>(base - a) + (*base < key);
+}
+// 返回第一个大于 key 的下标
+template <class T> int upper_bound(const T *a, int n, const T &key) {
+    if (n <= 0) {
+        return 0;
+    }
+    const T *base = a;
+    while (n > 1) {
+        int half = n / 2;
+        base = (base[half] > key) ? base : base + half;
+        n -= half;
+    }
+    return static_cast<int>(base - a) + !(*base > key);
+}
 
-    // 读出位置索引index对应的T对象的值并赋值给t，保证调用的index都是由write函数产生
-    void read(T &t, const int index) {
-        if (!file.is_open()) {
-            file.open(file_name, std::ios::in | std::ios::out);
-        }
-        int pos = info_len * sizeofsize_t + index * sizeofT;
-        file.seekg(pos);
-        file.read(reinterpret_cast<char *>(&t), sizeofT);
-    }
+#ifdef SJTU_HAS_AVX2
+// 先二分把范围缩到 kWINDOW 以内，再用 AVX2 一次比较 4 个键并计数
+inline int lower_bound_avx2(const unsigned long long *a, int n, unsigned long long key) {
+    static constexpr int kWINDOW = 16;
+    const unsigned long long *base = a;
+    while (n > kWINDOW) {
+        int half = n / 2;
+        base = (base[half] < key) ? base + half : base;
+        n -= half;
+    }
+    // 无符号比较：两边同时翻转符号位后做有符号比较
+    const __m256i flip = _mm256_set1_epi64x(static_cast<long long>(1ULL << 63));
+    const __m256i k = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<long long>(key)), flip);
+    int cnt = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(base + i));
+        __m256i lt = _mm256_cmpgt_epi64(k, _mm256_xor_si256(v, flip));
+        cnt += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+    }
+    for (; i < n; i++) {
+        cnt += base[i] < key;
+    }
+    return static_cast<int>(base - a) + cnt;
+}
+#endif
 
-    int size() {
-        return len_;
+// B+ 树节点内按键查找；打开 AVX2 编译时整数键走向量化路径
+template <class T> struct KeySearch {
+    static int LowerBound(T *a, int n, const T &key) { return lower_bound(a, n, key); }
+};
+template <> struct KeySearch<unsigned long long> {
+    static int LowerBound(unsigned long long *a, int n, const unsigned long long &key) {
+#ifdef SJTU_HAS_AVX2
+        return lower_bound_avx2(a, n, key);
+#else
+        return lower_bound(a, n, key);
+#endif
     }
-
-    // //删除位置索引index对应的对象(不涉及空间回收时，可忽略此函数)，保证调用的index都是由write函数产生
-    // void Delete(int index) {
-    //     /* your code here */
-    // }
 };
 
+// splitmix64 的收尾混合，让每一位输入影响所有输出位
+inline unsigned long long Mix64(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
 } // namespace sjtu
 
 using ull = unsigned long long;
-inline ull hash(std::string s) {
-    static constexpr ull base = 2333;
-    ull res = 0;
-    for (auto c : s) {
-        res = res * 10 + c;
-    }
-    return res;
+// 字符串的 64 位哈希：FNV-1a 逐字节累积后再混合一次，直接读字节，不构造临时字符串。
+// 各索引只存哈希，查到记录后由调用者和记录里的原串核对
+inline ull hash(const char *s, int n) {
+    ull res = 14695981039346656037ull;
+    for (int i = 0; i < n; i++) {
+        res = (res ^ static_cast<unsigned char>(s[i])) * 1099511628211ull;
+    }
+    return sjtu::Mix64(res ^ static_cast<ull>(n));
+}
+inline ull hash(const std::string &s) {
+    return hash(s.data(), static_cast<int>(s.size()));
+}
+template <int max_size> inline ull hash(const sjtu::MyString<max_size> &s) {
+    return hash(s.data(), s.size());
 }
 
 template <typename T, typename Compare>
@@ -833,4 +804,4 @@ inline void merge_sort(sjtu::vector<T>& vec, Compare comp) {
     vec = std::move(merged);
 }
 
-#endif // MYSTL_HPP
\ No newline at end of file
+#endif // MYSTL_HPP
@@ -9,70 +9,101 @@ enum class OrderStatus {kSUCCESS, kPENDING, kREFUNDED};
 struct Order {
     int time;
     string20 username;
-    string20 trainid;
+    int train;  // 车次编号
     TrainSystem::OrderInfo orderinfo;
-    string30 from, to;
+    short from, to;  // 站名编号
     int num;
     OrderStatus status;
-    bool operator < (const Order &other) {
+    bool operator < (const Order &other) const {
         return time < other.time;
     }
-    bool operator > (const Order &other) {
+    bool operator > (const Order &other) const {
         return time > other.time;
     }
-    bool operator == (const Order &other) {
+    bool operator == (const Order &other) const {
         return time == other.time;
     }
-    bool operator <= (const Order &other) {
+    bool operator <= (const Order &other) const {
         return !((*this) > other);
     }
-    bool operator >= (const Order &other) {
+    bool operator >= (const Order &other) const {
         return !((*this) < other);
     }
-    bool operator != (const Order &other) {
+    bool operator != (const Order &other) const {
         return !((*this) == other);
     }
 };
 
 class OrderSystem {
 private:
-    BPlusTree<ull, Order, 4, 8> userorder{"userorder"};
-    BPlusTree<ull, Order, 4, 8> trainorder{"trainorder"};
+    // 按用户名的哈希分组；哈希相同的别的用户的订单也在同一组里，遍历时按用户名跳过
+    BPlusTree<ull, Order, 4, 1 << 19> userorder{"userorder"};
+    BPlusTree<int, Order, 4, 1 << 19> trainorder{"trainorder"};
 
 public:
     void Clear() {
         userorder.Clear();
         trainorder.Clear();
     }
+    void Stats(std::ostream &os, bool full) {
+        userorder.Stats(os, full);
+        trainorder.Stats(os, full);
+    }
     void AddOrder(const Order &order) {
         userorder.Insert(hash(order.username), order);
         if (order.status == OrderStatus::kPENDING) {
-            trainorder.Insert(hash(order.trainid), order);
+            trainorder.Insert(order.train, order);
         }
     }
-    void DelOrder(const Order &order) {
-        userorder.Remove(hash(order.username), order);
+    vector<Order> GetRefund(int train) {
+        return trainorder.Find(train);
+    }
+    // 订单状态改为 status：userorder 按 (用户, 下单时间) 找到这一项原地修改，离开候补时从 trainorder 删除
+    void SetStatus(const Order &order, OrderStatus status) {
+        userorder.Update(hash(order.username), order, [&](Order &o) {
+            o.status = status;
+        });
         if (order.status == OrderStatus::kPENDING) {
-            trainorder.Remove(hash(order.trainid), order);
+            trainorder.Remove(order.train, order);
         }
     }
-    vector<Order> GetRefund(const string20 &trainid) {
-        return trainorder.Find(hash(trainid));
-    }
-    bool Refund(Order order) {
+    bool Refund(const Order &order) {
         if (order.status == OrderStatus::kREFUNDED) {
             return false;
         }
-        userorder.Remove(hash(order.username), order);
-        if (order.status == OrderStatus::kPENDING) {
-            trainorder.Remove(hash(order.trainid), order);
-        }
-        order.status = OrderStatus::kREFUNDED;
-        userorder.Insert(hash(order.username), order);
+        SetStatus(order, OrderStatus::kREFUNDED);
         return true;
     }
-    vector<Order> QueryOrder(const string20 &username) {
-        return  userorder.Find(hash(username));
+    int CountOrder(const string20 &username) {
+        ull h = hash(username);
+        int cnt = 0;
+        for (auto it = userorder.Seek(h); it.Valid() && it.Key() == h; it.Next()) {
+            cnt += it.Value().username == username;
+        }
+        return cnt;
+    }
+    // 从新到旧访问用户的订单，visit 返回 false 时提前结束
+    template <class F>
+    void QueryOrder(const string20 &username, F visit) {
+        ull h = hash(username);
+        for (auto it = userorder.SeekLast(h); it.Valid() && it.Key() == h; it.Prev()) {
+            if (it.Value().username == username && !visit(it.Value())) {
+                return;
+            }
+        }
+    }
+    // 用户第 n 新的订单
+    pair<Order, bool> NthOrder(const string20 &username, int n) {
+        if (n < 1) {
+            return {Order(), false};
+        }
+        ull h = hash(username);
+        for (auto it = userorder.SeekLast(h); it.Valid() && it.Key() == h; it.Prev()) {
+            if (it.Value().username == username && --n == 0) {
+                return {it.Value(), true};
+            }
+        }
+        return {Order(), false};
     }
 };
 
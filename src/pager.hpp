@@ -0,0 +1,324 @@
+#pragma once
+#ifndef PAGER_HPP
+#define PAGER_HPP
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// POSIX 接口不在作业允许的头文件里，默认只用 fstream；
+// 定义 SJTU_USE_POSIX（SJTU_USE_MMAP、SJTU_USE_DIRECT 也算；cmake 里是 -DSJTU_USE_POSIX=ON）时才用 pread/pwrite、mmap、fsync
+#if (defined(SJTU_USE_POSIX) || defined(SJTU_USE_MMAP) || defined(SJTU_USE_DIRECT)) && defined(__unix__) \
+    && __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SJTU_HAS_POSIX
+#endif
+
+namespace sjtu {
+
+// 数据文件的访问方式，按文件选择
+enum class FileMode {
+    kSTREAM,          // fstream 读写，没有 POSIX 接口时的后备
+    kPOSITIONAL,      // pread/pwrite
+    kDIRECT,          // pread/pwrite 加 O_DIRECT，不经过内核页缓存，只适合整页读写的文件
+    kMAP_RANDOM,      // mmap，随机访问
+    kMAP_SEQUENTIAL,  // mmap，顺序访问
+};
+
+// 评测按常驻内存计算内存占用，访问过的映射页也算在内，所以 POSIX 下也默认不用 mmap；
+// 编译时定义 SJTU_USE_MMAP 则默认改为 mmap
+#if !defined(SJTU_HAS_POSIX)
+inline constexpr FileMode kDEFAULT_FILEMODE = FileMode::kSTREAM;
+#elif defined(SJTU_USE_MMAP)
+inline constexpr FileMode kDEFAULT_FILEMODE = FileMode::kMAP_RANDOM;
+#else
+inline constexpr FileMode kDEFAULT_FILEMODE = FileMode::kPOSITIONAL;
+#endif
+
+// 按 64 位字节偏移读写一个文件，打开一次直到 Close。
+// 读到文件末尾之外的部分补 0（fstream 模式下保持不变）。
+// mmap 模式下文件按 kEXTENT 成段扩展，读写只是映射区上的一次拷贝；
+// O_DIRECT 模式下没有按 kBLOCK 对齐的读写经过一个对齐的中转缓冲区。
+// 关闭时把文件截回实际写到的长度。
+class Pager {
+public:
+    static constexpr int kBLOCK = 4096;
+
+private:
+    static constexpr long long kEXTENT = 1 << 20;
+
+    FileMode mode = FileMode::kSTREAM;
+    std::string name;
+    std::fstream stream;
+    long long end = 0;  // 实际写到的长度
+#ifdef SJTU_HAS_POSIX
+    int fd = -1;
+    char *base = nullptr;
+    long long capacity = 0;  // mmap 模式下映射区的长度，也是磁盘上文件的长度
+
+    bool Mapped() const { return mode == FileMode::kMAP_RANDOM || mode == FileMode::kMAP_SEQUENTIAL; }
+
+    // 保证映射区至少有 need 字节，不够时按 1.5 倍并对齐到 kEXTENT 扩展后重新映射
+    void Reserve(long long need) {
+        if (need <= capacity) {
+            return;
+        }
+        long long cap = capacity + capacity / 2;
+        if (cap < need) {
+            cap = need;
+        }
+        cap = (cap + kEXTENT - 1) / kEXTENT * kEXTENT;
+        if (base) {
+            munmap(base, capacity);
+            base = nullptr;
+        }
+        capacity = 0;
+        if (ftruncate(fd, cap) != 0) {
+            return;
+        }
+        void *p = mmap(nullptr, cap, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            return;
+        }
+        base = static_cast<char *>(p);
+        capacity = cap;
+        madvise(base, capacity, mode == FileMode::kMAP_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+
+    // 读满 n 字节，文件末尾之后补 0
+    void ReadAt(char *dst, long long off, long long n) {
+        long long done = 0;
+        while (done < n) {
+            ssize_t r = pread(fd, dst + done, n - done, off + done);
+            if (r <= 0) {
+                break;
+            }
+            done += r;
+        }
+        if (done < n) {
+            __builtin_memset(dst + done, 0, n - done);
+        }
+    }
+    void WriteAt(const char *src, long long off, long long n) {
+        long long done = 0;
+        while (done < n) {
+            ssize_t r = pwrite(fd, src + done, n - done, off + done);
+            if (r <= 0) {
+                break;
+            }
+            done += r;
+        }
+    }
+    static bool Aligned(const void *buf, long long off, long long n) {
+        return (reinterpret_cast<unsigned long>(buf) | static_cast<unsigned long>(off) | static_cast<unsigned long>(n)) % kBLOCK == 0;
+    }
+    // O_DIRECT 下不对齐的读写：把覆盖到的块读进对齐缓冲区，再拷贝（写时改完整块写回）
+    void Bounce(char *buf, long long off, int n, bool write) {
+        long long lo = off / kBLOCK * kBLOCK, hi = (off + n + kBLOCK - 1) / kBLOCK * kBLOCK;
+        char *tmp = static_cast<char *>(::operator new(hi - lo, std::align_val_t(kBLOCK)));
+        ReadAt(tmp, lo, hi - lo);
+        if (write) {
+            __builtin_memcpy(tmp + (off - lo), buf, n);
+            WriteAt(tmp, lo, hi - lo);
+        } else {
+            __builtin_memcpy(buf, tmp + (off - lo), n);
+        }
+        ::operator delete(tmp, std::align_val_t(kBLOCK));
+    }
+#endif
+
+public:
+    Pager() = default;
+    Pager(const Pager &) = delete;
+    Pager &operator=(const Pager &) = delete;
+    ~Pager() { Close(); }
+
+    // 打开文件，不存在则创建；truncate 为真时清空
+    void Open(const std::string &name, FileMode m, bool truncate) {
+        Close();
+        mode = m;
+        this->name = name;
+#ifdef SJTU_HAS_POSIX
+        if (mode != FileMode::kSTREAM) {
+            int flags = O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0);
+#ifdef O_DIRECT
+            if (mode == FileMode::kDIRECT) {
+                flags |= O_DIRECT;
+            }
+#endif
+            fd = open(name.c_str(), flags, 0644);
+            if (fd == -1 && mode == FileMode::kDIRECT) {
+                // 文件系统不支持 O_DIRECT（如 tmpfs）时退回普通的 pread/pwrite
+                mode = FileMode::kPOSITIONAL;
+                fd = open(name.c_str(), O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+            }
+            struct stat st;
+            end = (fd != -1 && fstat(fd, &st) == 0 ? st.st_size : 0);
+            if (Mapped()) {
+                Reserve(end);
+            }
+            return;
+        }
+#else
+        mode = FileMode::kSTREAM;
+#endif
+        // 读写都是整段的，不用 fstream 自己的缓冲，省一次拷贝和多余的系统调用
+        stream.rdbuf()->pubsetbuf(nullptr, 0);
+        if (!truncate) {
+            stream.open(name, std::ios::in | std::ios::out | std::ios::binary);
+        }
+        if (!stream.is_open()) {
+            stream.open(name, std::ios::out | std::ios::binary);
+            stream.close();
+            stream.open(name, std::ios::in | std::ios::out | std::ios::binary);
+        }
+        stream.seekg(0, std::ios::end);
+        end = stream.tellg();
+    }
+    bool IsOpen() const {
+#ifdef SJTU_HAS_POSIX
+        if (mode != FileMode::kSTREAM) {
+            return fd != -1;
+        }
+#endif
+        return stream.is_open();
+    }
+    void Close() {
+#ifdef SJTU_HAS_POSIX
+        if (mode != FileMode::kSTREAM) {
+            if (base) {
+                munmap(base, capacity);
+                base = nullptr;
+            }
+            capacity = 0;
+            if (fd != -1) {
+                if (ftruncate(fd, end) != 0) {
+                }
+                close(fd);
+                fd = -1;
+            }
+            return;
+        }
+#endif
+        if (stream.is_open()) {
+            stream.close();
+        }
+    }
+
+    long long Size() const { return end; }
+
+    // 提示内核预读 [off, off + n)，不等待。O_DIRECT 和 fstream 模式下没有效果
+    void Prefetch(long long off, int n) {
+#ifdef SJTU_HAS_POSIX
+        if (Mapped()) {
+            long long lo = off / kBLOCK * kBLOCK;
+            if (base && off + n <= capacity) {
+                madvise(base + lo, off + n - lo, MADV_WILLNEED);
+            }
+        } else if (mode == FileMode::kPOSITIONAL && fd != -1) {
+            posix_fadvise(fd, off, n, POSIX_FADV_WILLNEED);
+        }
+#else
+        (void)off, (void)n;
+#endif
+    }
+
+    // 等到此前写入的内容都落盘。fstream 模式下只能 flush 给内核，进程崩溃不丢，掉电可能丢
+    void Sync() {
+#ifdef SJTU_HAS_POSIX
+        if (Mapped()) {
+            if (base) {
+                msync(base, capacity, MS_SYNC);
+            }
+            return;
+        }
+        if (mode != FileMode::kSTREAM) {
+            if (fd != -1) {
+                fdatasync(fd);
+            }
+            return;
+        }
+#endif
+        stream.flush();
+    }
+
+    // 把文件截为 size 字节（mmap 模式下只截断逻辑长度，关闭时生效）
+    void Truncate(long long size) {
+        end = size;
+#ifdef SJTU_HAS_POSIX
+        if (Mapped()) {
+            return;
+        }
+        if (mode != FileMode::kSTREAM) {
+            if (fd != -1 && ftruncate(fd, size) != 0) {
+            }
+            return;
+        }
+#endif
+        stream.close();
+        std::filesystem::resize_file(name, size);
+        stream.rdbuf()->pubsetbuf(nullptr, 0);
+        stream.open(name, std::ios::in | std::ios::out | std::ios::binary);
+    }
+
+    void Read(void *buf, long long off, int n) {
+#ifdef SJTU_HAS_POSIX
+        if (Mapped()) {
+            char *dst = static_cast<char *>(buf);
+            int avail = (off >= capacity ? 0 : (capacity - off < n ? static_cast<int>(capacity - off) : n));
+            if (avail > 0) {
+                __builtin_memcpy(dst, base + off, avail);
+            }
+            if (avail < n) {
+                __builtin_memset(dst + avail, 0, n - avail);
+            }
+            return;
+        }
+        if (mode == FileMode::kDIRECT && !Aligned(buf, off, n)) {
+            Bounce(static_cast<char *>(buf), off, n, false);
+            return;
+        }
+        if (mode != FileMode::kSTREAM) {
+            ReadAt(static_cast<char *>(buf), off, n);
+            return;
+        }
+#endif
+        stream.seekg(off);
+        stream.read(static_cast<char *>(buf), n);
+        if (!stream) {
+            stream.clear();
+        }
+    }
+    void Write(const void *buf, long long off, int n) {
+        if (off + n > end) {
+            end = off + n;
+        }
+#ifdef SJTU_HAS_POSIX
+        if (Mapped()) {
+            Reserve(off + n);
+            if (base) {
+                __builtin_memcpy(base + off, buf, n);
+            }
+            return;
+        }
+        if (mode == FileMode::kDIRECT && !Aligned(buf, off, n)) {
+            Bounce(static_cast<char *>(const_cast<void *>(buf)), off, n, true);
+            return;
+        }
+        if (mode != FileMode::kSTREAM) {
+            WriteAt(static_cast<const char *>(buf), off, n);
+            return;
+        }
+#endif
+        stream.seekp(off);
+        stream.write(static_cast<const char *>(buf), n);
+    }
+};
+
+} // namespace sjtu
+
+#endif // PAGER_HPP
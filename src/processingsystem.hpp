@@ -183,6 +183,7 @@ private:
     void AddTrain() {
         auto s = GetToken();
         Train train;
+        MyArray<string30, 100> names;
         for (int i = 0; i < static_cast<int>(s.size()); i += 2) {
             if (s[i] == "-i") {
                 train.trainid = s[i + 1];
@@ -197,7 +198,7 @@ private:
                     while (j + len < n && s[i + 1][j + len] != '|') {
                         len++;
                     }
-                    train.stations.push_back(s[i + 1].substr(j, len));
+                    names.push_back(s[i + 1].substr(j, len));
                     j += len;
                 }
             } else if (s[i] == "-p") {
@@ -245,7 +246,7 @@ private:
                 train.type = s[i + 1][0];
             }
         }
-        auto tmp = trainsys.AddTrain(train);
+        auto tmp = trainsys.AddTrain(train, names);
         std::cout << (tmp ? 0 : -1) << "\n";
     }
     void DeleteTrain() {
@@ -306,14 +307,19 @@ private:
                 }
             }
         }
-        auto ans = trainsys.QueryTicket(from, to, date, order);
+        short st = trainsys.StationId(from), ed = trainsys.StationId(to);
+        if (st == -1 || ed == -1) {
+            std::cout << 0 << "\n";
+            return;
+        }
+        auto ans = trainsys.QueryTicket(st, ed, date, order);
         std::cout << ans.size() << "\n";
         for (auto p : ans) {
             std::cout << p.trainid << " ";
-            std::cout << p.from << " ";
+            std::cout << from << " ";
             std::cout << ToString2(p.leaving[0]) << "-" << ToString2(p.leaving[1]) << " ";
             std::cout << ToString2(p.leaving[2]) << ":" << ToString2(p.leaving[3]) << " -> ";
-            std::cout << p.to << " ";
+            std::cout << to << " ";
             std::cout << ToString2(p.arriving[0]) << "-" << ToString2(p.arriving[1]) << " ";
             std::cout << ToString2(p.arriving[2]) << ":" << ToString2(p.arriving[3]) << " ";
             std::cout << p.price << " " << p.seat << "\n";
@@ -340,17 +346,23 @@ private:
                 }
             }
         }
-        auto [ans, has_ans] = trainsys.QueryTransfer(from, to, date, order);
+        short st = trainsys.StationId(from), ed = trainsys.StationId(to);
+        if (st == -1 || ed == -1) {
+            std::cout << 0 << "\n";
+            return;
+        }
+        auto [ans, has_ans] = trainsys.QueryTransfer(st, ed, date, order);
         if (!has_ans) {
             std::cout << 0 << "\n";
             return;
         }
+        string30 mid = trainsys.StationName(ans.first.to);
         for (auto p : {ans.first, ans.second}) {
             std::cout << p.trainid << " ";
-            std::cout << p.from << " ";
+            std::cout << (p.from == st ? from : mid) << " ";
             std::cout << ToString2(p.leaving[0]) << "-" << ToString2(p.leaving[1]) << " ";
             std::cout << ToString2(p.leaving[2]) << ":" << ToString2(p.leaving[3]) << " -> ";
-            std::cout << p.to << " ";
+            std::cout << (p.to == ed ? to : mid) << " ";
             std::cout << ToString2(p.arriving[0]) << "-" << ToString2(p.arriving[1]) << " ";
             std::cout << ToString2(p.arriving[2]) << ":" << ToString2(p.arriving[3]) << " ";
             std::cout << p.price << " " << p.seat << "\n";
@@ -387,13 +399,16 @@ private:
             std::cout << -1 << "\n";
             return;
         }
-        auto [orderinfo, hasticket] = trainsys.BuyTickets(trainid, date, from, to, n);
+        // 没有这个站时编号为 -1，BuyTickets 找不到区间，按没有车处理
+        short st = trainsys.StationId(from), ed = trainsys.StationId(to);
+        int train = trainsys.TrainId(trainid);
+        auto [orderinfo, hasticket] = trainsys.BuyTickets(train, date, st, ed, n);
         Order order;
         order.orderinfo = orderinfo;
         order.time = timestamp;
         order.username = username;
-        order.trainid = trainid;
-        order.from = from, order.to = to;
+        order.train = train;
+        order.from = st, order.to = ed;
         order.num = n;
         int costs = orderinfo.price * n;
         if (!hasticket) {
@@ -422,19 +437,18 @@ private:
             std::cout << -1 << "\n";
             return;
         }
-        auto ans = ordersys.QueryOrder(username);
-        std::cout << ans.size() << "\n";
-        for (int i = static_cast<int>(ans.size()) - 1; i >= 0; i--) {
-            auto p = ans[i];
+        std::cout << ordersys.CountOrder(username) << "\n";
+        ordersys.QueryOrder(username, [&](const Order &p) {
             std::cout << "[" << (p.status == OrderStatus::kPENDING ? "pending" : (p.status == OrderStatus::kSUCCESS ? "success" : "refunded")) << "] ";
-            std::cout << p.trainid << " " << p.from << " ";
+            std::cout << trainsys.TrainName(p.train) << " " << trainsys.StationName(p.from) << " ";
             std::cout << ToString2(p.orderinfo.leaving[0]) << "-" << ToString2(p.orderinfo.leaving[1]) << " ";
             std::cout << ToString2(p.orderinfo.leaving[2]) << ":" << ToString2(p.orderinfo.leaving[3]) << " -> ";
-            std::cout << p.to << " ";
+            std::cout << trainsys.StationName(p.to) << " ";
             std::cout << ToString2(p.orderinfo.arriving[0]) << "-" << ToString2(p.orderinfo.arriving[1]) << " ";
             std::cout << ToString2(p.orderinfo.arriving[2]) << ":" << ToString2(p.orderinfo.arriving[3]) << " ";
             std::cout << p.orderinfo.price << " " << p.num << "\n";
-        }
+            return true;
+        });
     }
     void RefundTicket() {
         auto s = GetToken();
@@ -452,27 +466,31 @@ private:
             std::cout << -1 << "\n";
             return;
         }
-        auto p = ordersys.QueryOrder(username);
-        if (n > p.size()) {
+        auto [order, has] = ordersys.NthOrder(username, n);
+        if (!has) {
             std::cout << -1 << "\n";
             return;
         }
-        auto order = p[static_cast<int>(p.size()) - n];
         if (order.status == OrderStatus::kSUCCESS) {
-            trainsys.BuyTickets(order.trainid, {order.orderinfo.leaving[0], order.orderinfo.leaving[1]}, order.from, order.to, -order.num);
-            auto res = ordersys.GetRefund(order.trainid);
+            trainsys.BuyTickets(order.train, {order.orderinfo.leaving[0], order.orderinfo.leaving[1]}, order.from, order.to, -order.num);
+            auto res = ordersys.GetRefund(order.train);
             for (auto q : res) {
-                auto [orderinfo, hasticket] = trainsys.BuyTickets(q.trainid, {q.orderinfo.leaving[0], q.orderinfo.leaving[1]}, q.from, q.to, q.num);
+                auto [orderinfo, hasticket] = trainsys.BuyTickets(q.train, {q.orderinfo.leaving[0], q.orderinfo.leaving[1]}, q.from, q.to, q.num);
                 if (hasticket == 2) {
-                    ordersys.DelOrder(q);
-                    q.status = OrderStatus::kSUCCESS;
-                    ordersys.AddOrder(q);
+                    ordersys.SetStatus(q, OrderStatus::kSUCCESS);
                 }
             }
         }
         bool st = ordersys.Refund(order);
         std::cout << (st ? 0 : -1) << "\n";
     }
+    // 存储层的统计，每个结构一行；full 时树还要扫描叶子算装填率
+    void Stats(std::ostream &os, bool full) {
+        sjtu::Tablespace::Instance().Stats(os);
+        usersys.Stats(os, full);
+        trainsys.Stats(os, full);
+        ordersys.Stats(os, full);
+    }
     void Clean() {
         usersys.Clear();
         trainsys.Clear();
@@ -516,10 +534,15 @@ public:
                 RefundTicket();
             } else if (op == "clean") {
                 Clean();
+            } else if (op == "stats") {
+                Stats(std::cout, true);
             } else if (op == "exit") {
                 std::cout << "bye\n";
+                Stats(std::cerr, false);
                 break;
             }
+            sjtu::Tablespace::Instance().Commit();
+            sjtu::CacheGovernor::Instance().Tick();
         }
     }
 };
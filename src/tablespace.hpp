@@ -0,0 +1,723 @@
+#pragma once
+#ifndef TABLESPACE_HPP
+#define TABLESPACE_HPP
+
+#include <iostream>
+#include <string>
+#include "bufferpool.hpp"
+#include "latch.hpp"
+#include "mystl.hpp"
+#include "pager.hpp"
+
+namespace sjtu {
+
+// 表空间文件的访问方式。定义 SJTU_USE_DIRECT 时用 O_DIRECT，
+// B+ 树节点在缓存池和内核页缓存里就不会各存一份
+#if defined(SJTU_HAS_POSIX) && defined(SJTU_USE_DIRECT)
+inline constexpr FileMode kTABLESPACE_FILEMODE = FileMode::kDIRECT;
+#else
+inline constexpr FileMode kTABLESPACE_FILEMODE = kDEFAULT_FILEMODE;
+#endif
+
+// 预写日志（表空间文件名加 .wal）有 POSIX 接口时用 pread/pwrite 顺序追加，截断后立即生效；默认构建用 fstream
+#if defined(SJTU_HAS_POSIX)
+inline constexpr FileMode kWAL_FILEMODE = FileMode::kPOSITIONAL;
+#else
+inline constexpr FileMode kWAL_FILEMODE = FileMode::kSTREAM;
+#endif
+
+// 在组提交前要把缓存里的脏页写进表空间的结构（B+ 树的缓存池）
+class Flusher {
+public:
+    virtual void Flush() = 0;
+    virtual ~Flusher() = default;
+};
+
+// 所有数据放在同一个文件里，以 kBLOCK 字节为一块。
+// 第 0 块是超级块：目录（每个有名字的结构一项）和按长度分开的空闲段链表；
+// 其余的块按段（连续的若干块）分给各个结构，结构清空时段还回来给别的结构用。
+// 空闲段的下一个段存在该段第一块的前 4 个字节里。
+//
+// 写入先暂存在内存里（按块），每执行完 kGROUP_COMMANDS 条命令做一次组提交：
+// 缓存池的脏页不再复制一份，整块的直接借用缓存池里的页内存，和暂存块、超级块一起
+// 整块追加进日志并 sync，然后才写回原位。暂存区的份额和日志缓冲从 CacheGovernor 的预算里扣；
+// 一条命令暂存的块超过份额时，先把它们追加进日志（不写提交记录）腾出内存，用到时再读回。
+// 日志超过 kWAL_LIMIT 时做检查点：数据文件 sync 后清空日志。
+// 启动时把日志中完整的组按顺序重做一遍，崩溃最多丢掉最后一组还没提交的命令。
+// 默认构建没有 fsync（见 Pager::Sync），只保证进程崩溃时如此；掉电也要保证时用 SJTU_USE_POSIX 编译。
+// 暂存区、分配器和目录由 latch 保护；组提交要求此时没有别的线程在改数据。
+class Tablespace {
+public:
+    static constexpr int kBLOCK = Pager::kBLOCK;
+    static constexpr int kMAX_RUN = 64;
+    static constexpr int kMAX_ENTRIES = 48;
+    static constexpr int kNAME_LEN = 24;
+
+    struct Entry {
+        char name[kNAME_LEN];
+        int info[4];
+        int len;        // 记录数（含已删除的）
+        int free_head;  // 被删除记录组成的链表
+        int dir;        // 段目录链表的第一块
+    };
+
+private:
+    static constexpr int kMAGIC = 0x54535037;  // 索引键的格式变了就加一，旧文件按空库处理
+    static constexpr int kGROUP_COMMANDS = 64;
+    static constexpr int kGROUP_BLOCKS = 1024;  // 暂存块的份额是预算的 1/8，夹在这个数和 kSPARE_BLOCKS 之间
+    static constexpr int kSPARE_BLOCKS = 64;    // 提交后留着复用的块缓冲
+    static constexpr long long kWAL_LIMIT = 32ll << 20;
+    static constexpr int kWAL_BATCH = 64;       // 追加日志时一次写出的记录数
+
+    struct alignas(kBLOCK) Superblock {
+        int magic;
+        int blocks;  // 文件目前用到的块数
+        int freeruns[kMAX_RUN + 1];
+        Entry catalog[kMAX_ENTRIES];
+    };
+    static_assert(sizeof(Superblock) == kBLOCK, "superblock must fit in one block");
+
+    // 日志记录头：block >= 0 时后跟该块的完整内容，sum 为其校验和；
+    // block == -1 为提交记录，count 为本组的块数
+    struct WalRecord {
+        int block;
+        int count;
+        unsigned long long sum;
+    };
+    static constexpr int kWAL_RECORD = sizeof(WalRecord) + kBLOCK;
+
+    Latch latch;
+    Pager pager;
+    Pager wal;
+    long long walend = 0;
+    Superblock super;
+    vector<Flusher *> flushers;
+    int pending = 0;  // 上次组提交之后执行完的命令数
+    Counter groups, checkpoints;
+
+    // 暂存区：开放寻址表 slots 存块在 stagedblock/stageddata 中的下标。
+    // 组提交时借用的块 borrowed 为真，数据在缓存池里，提交完不归还；
+    // 挪进日志的块 stageddata 为空，内容在日志的 walpos 处
+    int *slots = nullptr;
+    int slotmask = -1;
+    vector<int> stagedblock;
+    vector<char *> stageddata;
+    vector<char> borrowed;
+    vector<long long> walpos;
+    int groupblocks;
+    int resident = 0;  // 暂存区自己持有的块数
+    int walcount = 0;  // 本组已经追加进日志的块数
+    bool committing = false;
+    vector<char *> spare;
+    char *walbuf;
+
+    struct alignas(kBLOCK) Block {
+        char data[kBLOCK];
+    };
+    static char *NewBlock() { return (new Block)->data; }
+    static void FreeBlock(char *p) { delete reinterpret_cast<Block *>(p); }
+    static unsigned long long Checksum(const char *data) {
+        unsigned long long h = 1469598103934665603ull, w;
+        for (int i = 0; i < kBLOCK; i += 8) {
+            __builtin_memcpy(&w, data + i, 8);
+            h = (h ^ w) * 1099511628211ull;
+        }
+        return h;
+    }
+
+    static int Hash(int block) { return static_cast<int>(static_cast<unsigned>(block) * 2654435761u >> 4); }
+    int FindStaged(int block) const {
+        if (stagedblock.empty()) {
+            return -1;
+        }
+        for (int h = Hash(block) & slotmask; slots[h] != -1; h = (h + 1) & slotmask) {
+            if (stagedblock[slots[h]] == block) {
+                return slots[h];
+            }
+        }
+        return -1;
+    }
+    void InsertSlot(int i) {
+        int h = Hash(stagedblock[i]) & slotmask;
+        while (slots[h] != -1) {
+            h = (h + 1) & slotmask;
+        }
+        slots[h] = i;
+    }
+    // 块 block 的暂存副本，没有就新建；whole 为真时调用者会覆盖整块，不必读原内容
+    char *Stage(int block, bool whole) {
+        int i = FindStaged(block);
+        if (i != -1 && stageddata[i] && !borrowed[i]) {
+            return stageddata[i];
+        }
+        char *data = TakeBlock();
+        if (i != -1) {
+            if (borrowed[i]) {
+                __builtin_memcpy(data, stageddata[i], kBLOCK);
+                borrowed[i] = false;
+            } else {
+                wal.Read(data, walpos[i] + static_cast<long long>(sizeof(WalRecord)), kBLOCK);
+            }
+            stageddata[i] = data;
+            return data;
+        }
+        if (!whole) {
+            __builtin_memset(data, 0, kBLOCK);
+            pager.Read(data, Offset(block), kBLOCK);
+        }
+        AddStaged(block, data, false);
+        return data;
+    }
+    char *TakeBlock() {
+        if (resident >= groupblocks) {
+            Spill();
+        }
+        resident++;
+        if (spare.empty()) {
+            return NewBlock();
+        }
+        char *data = spare.back();
+        spare.pop_back();
+        return data;
+    }
+    void AddStaged(int block, char *data, bool borrow) {
+        if (2 * (stagedblock.size() + 1) > slotmask + 1) {
+            int cap = (slotmask + 1) * 2;
+            if (cap < 256) {
+                cap = 256;
+            }
+            delete[] slots;
+            slots = new int[cap];
+            slotmask = cap - 1;
+            for (int h = 0; h < cap; h++) {
+                slots[h] = -1;
+            }
+            for (int j = 0; j < stagedblock.size(); j++) {
+                InsertSlot(j);
+            }
+        }
+        stagedblock.push_back(block);
+        stageddata.push_back(data);
+        borrowed.push_back(borrow);
+        walpos.push_back(-1);
+        InsertSlot(stagedblock.size() - 1);
+    }
+
+    // 读写先经过暂存区；连续的未暂存块合成一次读
+    void ReadStaged(void *buf, long long off, int n) {
+        char *dst = static_cast<char *>(buf);
+        if (stagedblock.empty()) {
+            pager.Read(dst, off, n);
+            return;
+        }
+        long long cold = off;  // [cold, off) 还没读
+        while (n > 0) {
+            int in = static_cast<int>(off % kBLOCK), len = (n < kBLOCK - in ? n : kBLOCK - in);
+            int i = FindStaged(static_cast<int>(off / kBLOCK));
+            if (i != -1) {
+                if (cold < off) {
+                    pager.Read(dst - (off - cold), cold, static_cast<int>(off - cold));
+                }
+                if (stageddata[i]) {
+                    __builtin_memcpy(dst, stageddata[i] + in, len);
+                } else {
+                    wal.Read(dst, walpos[i] + static_cast<long long>(sizeof(WalRecord)) + in, len);
+                }
+                cold = off + len;
+            }
+            off += len, dst += len, n -= len;
+        }
+        if (cold < off) {
+            pager.Read(dst - (off - cold), cold, static_cast<int>(off - cold));
+        }
+    }
+    // borrow 为真时（组提交中），没暂存过的整块直接借用 buf，不复制；buf 要保持到提交结束
+    void WriteStaged(const void *buf, long long off, int n, bool borrow = false) {
+        const char *src = static_cast<const char *>(buf);
+        while (n > 0) {
+            int in = static_cast<int>(off % kBLOCK), len = (n < kBLOCK - in ? n : kBLOCK - in);
+            int block = static_cast<int>(off / kBLOCK);
+            if (borrow && len == kBLOCK && FindStaged(block) == -1) {
+                AddStaged(block, const_cast<char *>(src), true);
+            } else {
+                __builtin_memcpy(Stage(block, len == kBLOCK) + in, src, len);
+            }
+            off += len, src += len, n -= len;
+        }
+    }
+
+    // 空闲段链表头插
+    void PushRun(int block, int n) {
+        WriteStaged(&super.freeruns[n], Offset(block), sizeof(int));
+        super.freeruns[n] = block;
+    }
+
+    // 返回记录在日志里的位置
+    long long AppendWal(const WalRecord &rec, const char *data, int &batched) {
+        long long pos = walend + static_cast<long long>(batched) * kWAL_RECORD;
+        char *p = walbuf + static_cast<long long>(batched) * kWAL_RECORD;
+        __builtin_memcpy(p, &rec, sizeof(rec));
+        int n = sizeof(rec);
+        if (data) {
+            __builtin_memcpy(p + n, data, kBLOCK);
+            n += kBLOCK;
+            walcount++;
+        }
+        batched++;
+        if (!data || batched == kWAL_BATCH) {
+            FlushWal(batched, n);
+        }
+        return pos;
+    }
+    // 写出攒着的记录，最后一条长 last 字节
+    void FlushWal(int &batched, int last = kWAL_RECORD) {
+        if (batched == 0) {
+            return;
+        }
+        long long bytes = static_cast<long long>(batched - 1) * kWAL_RECORD + last;
+        wal.Write(walbuf, walend, static_cast<int>(bytes));
+        walend += bytes;
+        batched = 0;
+    }
+
+    // 把暂存区自己持有的块追加进日志并归还内存。这一组还没有提交记录，
+    // 崩溃后重做时会整组丢掉；同一块后来又写进日志的话，重做时后写的覆盖先写的
+    void Spill() {
+        int batched = 0;
+        for (int i = 0; i < stagedblock.size(); i++) {
+            if (!stageddata[i] || borrowed[i]) {
+                continue;
+            }
+            walpos[i] = AppendWal({stagedblock[i], 0, Checksum(stageddata[i])}, stageddata[i], batched);
+            ReleaseBlock(stageddata[i]);
+            stageddata[i] = nullptr;
+        }
+        FlushWal(batched);
+    }
+    void ReleaseBlock(char *data) {
+        resident--;
+        if (spare.size() < kSPARE_BLOCKS) {
+            spare.push_back(data);
+        } else {
+            FreeBlock(data);
+        }
+    }
+
+    // 重做日志里每个完整的组，然后做检查点
+    void Replay() {
+        long long size = wal.Size(), pos = 0, start = 0;
+        int count = 0;
+        char *data = NewBlock();
+        WalRecord rec;
+        while (pos + static_cast<long long>(sizeof(rec)) <= size) {
+            wal.Read(&rec, pos, sizeof(rec));
+            pos += sizeof(rec);
+            if (rec.block >= 0) {
+                if (pos + kBLOCK > size) {
+                    break;
+                }
+                wal.Read(data, pos, kBLOCK);
+                pos += kBLOCK;
+                if (Checksum(data) != rec.sum) {
+                    break;
+                }
+                count++;
+                continue;
+            }
+            if (rec.block != -1 || rec.count != count) {
+                break;
+            }
+            for (; count > 0; count--, start += kWAL_RECORD) {
+                wal.Read(&rec, start, sizeof(rec));
+                wal.Read(data, start + sizeof(rec), kBLOCK);
+                pager.Write(data, Offset(rec.block), kBLOCK);
+            }
+            start = pos;
+        }
+        FreeBlock(data);
+        if (size > 0) {
+            Checkpoint();
+        }
+    }
+
+    void Format() {
+        __builtin_memset(&super, 0, sizeof(super));
+        super.magic = kMAGIC;
+        super.blocks = 1;
+        for (int i = 0; i <= kMAX_RUN; i++) {
+            super.freeruns[i] = -1;
+        }
+    }
+
+public:
+    explicit Tablespace(const std::string &filename) {
+        groupblocks = static_cast<int>(CacheGovernor::Instance().Budget() / 8 / kBLOCK);
+        groupblocks = groupblocks > kGROUP_BLOCKS ? kGROUP_BLOCKS : (groupblocks < kSPARE_BLOCKS ? kSPARE_BLOCKS : groupblocks);
+        CacheGovernor::Instance().Reserve(ReservedBytes());
+        walbuf = new char[kWAL_BATCH * kWAL_RECORD];
+        pager.Open(filename, kTABLESPACE_FILEMODE, false);
+        wal.Open(filename + ".wal", kWAL_FILEMODE, false);
+        Replay();
+        if (pager.Size() >= kBLOCK) {
+            pager.Read(&super, 0, kBLOCK);
+        }
+        if (pager.Size() < kBLOCK || super.magic != kMAGIC) {
+            Format();
+        }
+    }
+    Tablespace(const Tablespace &) = delete;
+    Tablespace &operator=(const Tablespace &) = delete;
+    ~Tablespace() {
+        GroupCommit();
+        Checkpoint();
+        for (int i = 0; i < spare.size(); i++) {
+            FreeBlock(spare[i]);
+        }
+        delete[] slots;
+        delete[] walbuf;
+        wal.Close();
+        pager.Close();
+        CacheGovernor::Instance().Reserve(-ReservedBytes());
+    }
+    long long ReservedBytes() const {
+        return static_cast<long long>(groupblocks) * kBLOCK + static_cast<long long>(kWAL_BATCH) * kWAL_RECORD;
+    }
+
+    // 进程里唯一的表空间，第一次用到时打开
+    static Tablespace &Instance() {
+        static Tablespace ts("tickets.db");
+        return ts;
+    }
+
+    void Attach(Flusher *f) {
+        flushers.push_back(f);
+    }
+    void Detach(Flusher *f) {
+        for (int i = 0; i < flushers.size(); i++) {
+            if (flushers[i] == f) {
+                flushers[i] = flushers.back();
+                flushers.pop_back();
+                return;
+            }
+        }
+    }
+
+    // 一条命令执行完，攒够一组或暂存块太多时提交
+    void Commit() {
+        if (++pending >= kGROUP_COMMANDS || stagedblock.size() >= groupblocks) {
+            GroupCommit();
+        }
+    }
+
+    // 把脏页、超级块和暂存的块写进日志并 sync，再写回原位
+    void GroupCommit() {
+        pending = 0;
+        groups.Add();
+        committing = true;
+        for (int i = 0; i < flushers.size(); i++) {
+            flushers[i]->Flush();
+        }
+        LatchGuard guard(latch, true);
+        committing = false;
+        WriteStaged(&super, 0, kBLOCK);
+        int n = stagedblock.size(), batched = 0;
+        for (int i = 0; i < n; i++) {
+            if (stageddata[i]) {
+                AppendWal({stagedblock[i], 0, Checksum(stageddata[i])}, stageddata[i], batched);
+            }
+        }
+        AppendWal({-1, walcount, 0}, nullptr, batched);
+        wal.Sync();
+        char *scratch = nullptr;
+        for (int i = 0; i < n; i++) {
+            if (!stageddata[i]) {
+                if (!scratch) {
+                    scratch = NewBlock();
+                }
+                wal.Read(scratch, walpos[i] + static_cast<long long>(sizeof(WalRecord)), kBLOCK);
+                pager.Write(scratch, Offset(stagedblock[i]), kBLOCK);
+                continue;
+            }
+            pager.Write(stageddata[i], Offset(stagedblock[i]), kBLOCK);
+            if (!borrowed[i]) {
+                ReleaseBlock(stageddata[i]);
+            }
+        }
+        if (scratch) {
+            FreeBlock(scratch);
+        }
+        walcount = 0;
+        stagedblock.clear();
+        stageddata.clear();
+        borrowed.clear();
+        walpos.clear();
+        for (int h = 0; h <= slotmask; h++) {
+            slots[h] = -1;
+        }
+        if (walend >= kWAL_LIMIT) {
+            Checkpoint();
+        }
+    }
+
+    // 数据文件落盘后日志就没用了
+    void Checkpoint() {
+        checkpoints.Add();
+        pager.Sync();
+        wal.Truncate(0);
+        wal.Sync();
+        walend = 0;
+    }
+
+    // 一行统计：文件大小、暂存的块、日志长度和启动以来的组提交、检查点次数
+    void Stats(std::ostream &os) {
+        LatchGuard guard(latch, true);
+        os << "tablespace blocks=" << super.blocks << " bytes=" << Offset(super.blocks)
+           << " staged=" << stagedblock.size() << " wal=" << walend
+           << " groups=" << groups.Get() << " checkpoints=" << checkpoints.Get() << "\n";
+    }
+
+    // 按名字找目录项，没有就新建
+    Entry *Lookup(const std::string &name) {
+        LatchGuard guard(latch, true);
+        Entry *empty = nullptr;
+        for (int i = 0; i < kMAX_ENTRIES; i++) {
+            Entry &e = super.catalog[i];
+            if (!e.name[0]) {
+                if (!empty) {
+                    empty = &e;
+                }
+            } else if (name == e.name) {
+                return &e;
+            }
+        }
+        if (!empty) {
+            throw runtime_error();
+        }
+        __builtin_memset(empty, 0, sizeof(Entry));
+        __builtin_strncpy(empty->name, name.c_str(), kNAME_LEN - 1);
+        empty->free_head = -1;
+        empty->dir = -1;
+        return empty;
+    }
+
+    // 分配连续 n 块，优先用长度正好的空闲段，其次从更长的空闲段里切
+    int AllocRun(int n) {
+        LatchGuard guard(latch, true);
+        for (int len = n; len <= kMAX_RUN; len++) {
+            int block = super.freeruns[len];
+            if (block == -1) {
+                continue;
+            }
+            ReadStaged(&super.freeruns[len], Offset(block), sizeof(int));
+            if (len > n) {
+                PushRun(block + n, len - n);
+            }
+            return block;
+        }
+        int block = super.blocks;
+        super.blocks += n;
+        return block;
+    }
+    void FreeRun(int block, int n) {
+        LatchGuard guard(latch, true);
+        PushRun(block, n);
+    }
+
+    static long long Offset(int block) { return static_cast<long long>(block) * kBLOCK; }
+
+    void Read(void *buf, long long off, int n) {
+        LatchGuard guard(latch, true);
+        ReadStaged(buf, off, n);
+    }
+    void Prefetch(long long off, int n) {
+        LatchGuard guard(latch, true);
+        pager.Prefetch(off, n);
+    }
+    void Write(const void *buf, long long off, int n) {
+        LatchGuard guard(latch, true);
+        WriteStaged(buf, off, n, committing);
+    }
+};
+
+// 表空间里的一个记录堆，接口和原来的单文件版本一样。
+// 记录按下标存放在若干个段里，每段 per_extent 条，段的起始块记在一串目录块中。
+template <class T, int info_len = 4> class MemoryRiver {
+private:
+    static_assert(info_len <= 4, "at most 4 info ints per heap");
+    static constexpr int kBLOCK = Tablespace::kBLOCK;
+    static constexpr int kEXTENT_BYTES = 256 << 10;
+    static constexpr int kPER_EXTENT = sizeof(T) >= kEXTENT_BYTES ? 1 : kEXTENT_BYTES / static_cast<int>(sizeof(T));
+    static constexpr int kEXTENT_BLOCKS = (kPER_EXTENT * static_cast<long long>(sizeof(T)) + kBLOCK - 1) / kBLOCK;
+    static_assert(kEXTENT_BLOCKS <= Tablespace::kMAX_RUN, "record too large for one extent");
+    // 目录块：下一块、本块的段数、各段起始块
+    static constexpr int kDIR_SLOTS = kBLOCK / sizeof(int) - 2;
+
+    Tablespace *ts = nullptr;
+    Tablespace::Entry *entry = nullptr;
+    int sizeofT = sizeof(T);
+    vector<int> extents;
+    vector<int> dirs;
+    Latch latch;  // 读写记录共享，分配、删除和清空时独占
+    Counter reads, writes;
+
+    long long record_pos(int index) const {
+        return Tablespace::Offset(extents[index / kPER_EXTENT]) +
+               static_cast<long long>(index % kPER_EXTENT) * sizeofT;
+    }
+    // 保证第 index 条记录所在的段已经分配
+    void reserve(int index) {
+        while (index / kPER_EXTENT >= static_cast<int>(extents.size())) {
+            int slot = static_cast<int>(extents.size()) % kDIR_SLOTS;
+            if (slot == 0) {
+                int block = ts->AllocRun(1);
+                int head[2] = {-1, 0};
+                ts->Write(head, Tablespace::Offset(block), sizeof(head));
+                if (dirs.empty()) {
+                    entry->dir = block;
+                } else {
+                    ts->Write(&block, Tablespace::Offset(dirs.back()), sizeof(int));
+                }
+                dirs.push_back(block);
+            }
+            int extent = ts->AllocRun(kEXTENT_BLOCKS);
+            int count = slot + 1;
+            ts->Write(&extent, Tablespace::Offset(dirs.back()) + (2 + slot) * sizeof(int), sizeof(int));
+            ts->Write(&count, Tablespace::Offset(dirs.back()) + sizeof(int), sizeof(int));
+            extents.push_back(extent);
+        }
+    }
+    void load_extents() {
+        extents.clear();
+        dirs.clear();
+        for (int block = entry->dir; block != -1;) {
+            int buf[kBLOCK / sizeof(int)];
+            ts->Read(buf, Tablespace::Offset(block), kBLOCK);
+            dirs.push_back(block);
+            for (int i = 0; i < buf[1]; i++) {
+                extents.push_back(buf[2 + i]);
+            }
+            block = buf[0];
+        }
+    }
+
+public:
+    MemoryRiver() = default;
+
+    MemoryRiver(const std::string &file_name) {
+        initialise(file_name, 1);
+    }
+
+    // 清空记录，所有段和目录块还给表空间
+    void clear() {
+        LatchGuard guard(latch, true);
+        for (int i = 0; i < static_cast<int>(extents.size()); i++) {
+            ts->FreeRun(extents[i], kEXTENT_BLOCKS);
+        }
+        for (int i = 0; i < static_cast<int>(dirs.size()); i++) {
+            ts->FreeRun(dirs[i], 1);
+        }
+        extents.clear();
+        dirs.clear();
+        entry->dir = -1;
+        entry->len = 0;
+        entry->free_head = -1;
+        for (int i = 0; i < info_len; i++) {
+            entry->info[i] = 0;
+        }
+    }
+
+    // 在表空间中打开名为 FN 的堆；clear_file 为 0 时清空
+    void initialise(std::string FN = "", bool clear_file = 0) {
+        ts = &Tablespace::Instance();
+        entry = ts->Lookup(FN);
+        load_extents();
+        if (clear_file == 0) {
+            clear();
+        }
+    }
+
+    // 读出第n个int的值赋给tmp，1_base
+    void get_info(int &tmp, int n) {
+        if (n > info_len)
+            return;
+        tmp = entry->info[n - 1];
+    }
+
+    // 将tmp写入第n个int的位置，1_base
+    void write_info(int tmp, int n) {
+        if (n > info_len)
+            return;
+        entry->info[n - 1] = tmp;
+    }
+
+    // 在文件合适位置写入类对象t，并返回写入的位置索引index
+    // 位置索引意味着当输入正确的位置索引index，在以下三个函数中都能顺利的找到目标对象进行操作
+    // 位置索引index可以取为对象写入的起始位置
+    int write(T &t) {
+        int index = alloc();
+        update(t, index);
+        return index;
+    }
+
+    // 分配一个位置索引但暂不写入，内容由调用者之后通过 update 写入
+    // 优先复用空闲链表中被 Delete 的位置
+    int alloc() {
+        LatchGuard guard(latch, true);
+        if (entry->free_head != -1) {
+            int index = entry->free_head;
+            ts->Read(&entry->free_head, record_pos(index), sizeof(int));
+            return index;
+        }
+        reserve(entry->len);
+        return entry->len++;
+    }
+
+    // 用t的值更新位置索引index对应的对象，保证调用的index都是由write函数产生
+    void update(T &t, const int index) {
+        LatchGuard guard(latch, false);
+        ts->Write(&t, record_pos(index), sizeofT);
+        writes.Add();
+    }
+
+    // 读出位置索引index对应的T对象的值并赋值给t，保证调用的index都是由write函数产生
+    void read(T &t, const int index) {
+        LatchGuard guard(latch, false);
+        ts->Read(&t, record_pos(index), sizeofT);
+        reads.Add();
+    }
+
+    int size() {
+        return entry->len;
+    }
+    // 有被 Delete 的位置可以复用，下一次 alloc 不会让 size 变大
+    bool has_free() {
+        return entry->free_head != -1;
+    }
+
+    const char *name() const {
+        return entry->name;
+    }
+    // 一行统计：记录数、占用的字节数、启动以来的读写次数
+    void stats(std::ostream &os) {
+        os << entry->name << " heap records=" << entry->len
+           << " bytes=" << static_cast<long long>(extents.size()) * kEXTENT_BLOCKS * kBLOCK
+           << " reads=" << reads.Get() << " writes=" << writes.Get() << "\n";
+    }
+
+    // 提示预读位置索引 index 对应的对象
+    void prefetch(const int index) {
+        LatchGuard guard(latch, false);
+        ts->Prefetch(record_pos(index), sizeofT);
+    }
+
+    // 删除位置索引index对应的对象并回收空间，保证调用的index都是由write函数产生
+    void Delete(int index) {
+        LatchGuard guard(latch, true);
+        ts->Write(&entry->free_head, record_pos(index), sizeof(int));
+        entry->free_head = index;
+    }
+};
+
+} // namespace sjtu
+
+#endif // TABLESPACE_HPP
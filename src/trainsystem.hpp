@@ -5,15 +5,16 @@
 #include <climits>
 #include <string>
 #include "bpt.hpp"
+#include "dictionary.hpp"
 #include "mystl.hpp"
 #include "usersystem.hpp"
 
 using sjtu::MyArray;
 
+// add_train 的参数，加入时换算成 TrainSystem 里存的记录
 struct Train {
     string20 trainid;
     short stationnum;
-    MyArray<string30, 100> stations;
     int seatnum;
     MyArray<int, 100> prices;
     pair<short, short> starttime; // (hh, mm)
@@ -21,40 +22,56 @@ struct Train {
     MyArray<short, 100> stopovertimes;
     pair<pair<short, short>, pair<short, short>> saledates; // (begin, end); (mm, dd);
     char type;
-    bool operator < (const Train &other) {
+    bool operator < (const Train &other) const {
         return trainid < other.trainid;
     }
-    bool operator > (const Train &other) {
+    bool operator > (const Train &other) const {
         return trainid > other.trainid;
     }
-    bool operator == (const Train &other) {
+    bool operator == (const Train &other) const {
         return trainid == other.trainid;
     }
-    bool operator <= (const Train &other) {
+    bool operator <= (const Train &other) const {
         return !((*this) > other);
     }
-    bool operator >= (const Train &other) {
+    bool operator >= (const Train &other) const {
         return !((*this) < other);
     }
-    bool operator != (const Train &other) {
+    bool operator != (const Train &other) const {
         return !((*this) == other);
     }
 };
 
 class TrainSystem {
 private:
-    BPlusTree<ull, short> trainidx{"trainidx"};
-    sjtu::MemoryRiver<Train> trains;
-    BPlusTree<ull, bool> released{"released"};
+    Dictionary<30> stationdict{"station"};
+    // 车次号到车次编号，编号就是 trains 里的记录下标；内部只用编号，车次号只在输入输出时转换。
+    // 删除车次时编号还给字典，记录的位置留给之后复用这个编号的车次
+    Dictionary<20, int> traindict{"train"};
+    // 车次记录。站名、车次号在字典里，这里只存编号；时间和票价存前缀和，
+    // 任意一段的出发、到达时间和票价都能直接算出，不用再沿途累加
+    struct TrainRecord {
+        string20 trainid;
+        short stationnum;
+        int seatnum;
+        pair<pair<short, short>, pair<short, short>> saledates;
+        char type;
+        MyArray<short, 100> stations;
+        MyArray<int, 100> arriving, leaving;  // 从始发日 0 点起的分钟数；始发站的 arriving、终点站的 leaving 不用
+        MyArray<int, 100> prices;  // 始发站到各站的票价
+        MyArray<pair<short, short>, 100> positions;  // (站编号, 在车次里的位置)，按站编号排序
+    };
+    sjtu::MemoryRiver<TrainRecord> trains;
+    BPlusMap<int, bool, 4, 1 << 20, 1 << 15> released{"released"};
     struct RemainSeat {
         short stationnum;
         MyArray<int, 100> seats;
     };
-    using TrainInDay = pair<pair<short, short>, ull>; // date, id
-    BPlusTree<TrainInDay, int> remainseatidx{"remainseatidx"};
+    using TrainInDay = pair<pair<short, short>, int>; // date, id
+    BPlusMap<TrainInDay, int> remainseatidx{"remainseatidx"};
     MemoryRiver<RemainSeat> remainseat;
     struct TrainTicket {
-        string20 trainid;
+        int train;
         short addday;
         MyArray<short, 2> leaving, arriving;
         short deltaday;
@@ -62,35 +79,35 @@ private:
         int cost;
     };
     MemoryRiver<TrainTicket> ticketidx;
-    BPlusTree<pair<ull, ull>, int, 4, 8> trainticket{"trainticket"};
+    BPlusTree<pair<short, short>, int, 4, 1 << 19> trainticket{"trainticket"};
     struct TransferInfo {
         int ticketidx;
         pair<pair<short, short>, pair<short, short>> saledates;
-        bool operator < (const TransferInfo &other) {
+        bool operator < (const TransferInfo &other) const {
             return ticketidx < other.ticketidx;
         }
-        bool operator > (const TransferInfo &other) {
+        bool operator > (const TransferInfo &other) const {
             return ticketidx > other.ticketidx;
         }
-        bool operator == (const TransferInfo &other) {
+        bool operator == (const TransferInfo &other) const {
             return ticketidx == other.ticketidx;
         }
-        bool operator <= (const TransferInfo &other) {
+        bool operator <= (const TransferInfo &other) const {
             return ticketidx <= other.ticketidx;
         }
-        bool operator >= (const TransferInfo &other) {
+        bool operator >= (const TransferInfo &other) const {
             return ticketidx >= other.ticketidx;
         }
-        bool operator != (const TransferInfo &other) {
+        bool operator != (const TransferInfo &other) const {
             return ticketidx != other.ticketidx;
         }
     };
-    BPlusTree<ull, string30> stations{"stations"};
-    BPlusTree<pair<ull, ull>, TransferInfo> transnext{"transnext"};
+    BPlusTree<short, short> stations{"stations"};
+    BPlusTree<pair<short, short>, TransferInfo, 4, 1 << 20, MultiKey, 1 << 18> transnext{"transnext"};
 
     pair<short, short> AddDay(pair<short, short> date, int x) {
         date.second += x;
-        if (date.second > (date.first == 6 ? 30 : 31)) {
+        while (date.second > (date.first == 6 ? 30 : 31)) {
             date.second -= (date.first == 6 ? 30 : 31);
             ++date.first;
         }
@@ -118,6 +135,19 @@ private:
         res += (b[2] * 60 + b[3]) - (a[2] * 60 + a[3]);
         return res;
     };
+    // 从 date 0 点起 minutes 分钟后的 (mm, dd, hh, mi)
+    MyArray<short, 4> At(pair<short, short> date, int minutes) {
+        MyArray<short, 4> res;
+        date = AddDay(date, minutes / 1440);
+        res[0] = date.first, res[1] = date.second, res[2] = minutes % 1440 / 60, res[3] = minutes % 60;
+        return res;
+    }
+    // 站在车次里的位置，不经过时返回 -1
+    int Position(const TrainRecord &train, short station) {
+        const auto &pos = train.positions;
+        int k = sjtu::lower_bound(pos.data(), pos.size(), pair<short, short>{station, -1});
+        return k < pos.size() && pos[k].first == station ? pos[k].second : -1;
+    }
 
 public:
     TrainSystem() {
@@ -133,43 +163,101 @@ public:
         trainticket.Clear();
         stations.Clear();
         transnext.Clear();
-        trainidx.Clear();
+        traindict.Clear();
         remainseatidx.Clear();
         ticketidx.clear();
+        stationdict.Clear();
+    }
+    void Stats(std::ostream &os, bool full) {
+        stationdict.Stats(os, full);
+        traindict.Stats(os, full);
+        trains.stats(os);
+        released.Stats(os, full);
+        remainseatidx.Stats(os, full);
+        remainseat.stats(os);
+        ticketidx.stats(os);
+        trainticket.Stats(os, full);
+        stations.Stats(os, full);
+        transnext.Stats(os, full);
     }
-    bool AddTrain(const Train &train) {
-        if (trainidx.Find(hash(train.trainid)).size()) {
+    // 站名编号，没有这个站时返回 -1
+    short StationId(const string30 &name) {
+        return stationdict.Find(name);
+    }
+    string30 StationName(short id) {
+        return stationdict.Get(id);
+    }
+    // 车次编号，没有这个车次时返回 -1
+    int TrainId(const string20 &trainid) {
+        return traindict.Find(trainid);
+    }
+    string20 TrainName(int id) {
+        return traindict.Get(id);
+    }
+    bool AddTrain(const Train &train, const MyArray<string30, 100> &names) {
+        if (traindict.Find(train.trainid) != -1) {
             return false;
         }
-        int idx = trains.write(const_cast<Train&>(train));
-        trainidx.Insert(hash(train.trainid), idx);
+        TrainRecord rec;
+        rec.trainid = train.trainid;
+        rec.stationnum = train.stationnum;
+        rec.seatnum = train.seatnum;
+        rec.saledates = train.saledates;
+        rec.type = train.type;
+        int minutes = train.starttime.first * 60 + train.starttime.second, cost = 0;
+        for (int i = 0; i < train.stationnum; i++) {
+            short station = stationdict.Insert(names[i]);
+            rec.stations.push_back(station);
+            pair<short, short> pos = {station, (short)i};
+            rec.positions.Insert(sjtu::lower_bound(rec.positions.data(), rec.positions.size(), pos), pos);
+            if (i > 0) {
+                minutes += train.traveltimes[i - 1];
+                cost += train.prices[i - 1];
+            }
+            rec.arriving.push_back(minutes);
+            if (i > 0 && i + 1 < train.stationnum) {
+                minutes += train.stopovertimes[i - 1];
+            }
+            rec.leaving.push_back(minutes);
+            rec.prices.push_back(cost);
+        }
+        // trains 从不删除记录：复用的编号写回原位，新编号正好是下一条记录
+        int id = traindict.Insert(train.trainid);
+        if (id == trains.size()) {
+            trains.write(rec);
+        } else {
+            trains.update(rec, id);
+        }
         return true;
     }
-    bool DeleteTrain(const string20 &trainid) {
-        auto p = trainidx.Find(hash(trainid));
-        if (!p.size()) {
-            return false;
+    // 读出 trainid 对应的车次，返回它的编号；不存在时返回 -1
+    int GetTrain(const string20 &trainid, TrainRecord &train) {
+        int id = traindict.Find(trainid);
+        if (id == -1) {
+            return -1;
         }
-        int idx = p[0];
-        Train train;
-        trains.read(train, idx);
-        if (released.Find(hash(trainid)).size()) {
+        trains.read(train, id);
+        return id;
+    }
+    bool DeleteTrain(const string20 &trainid) {
+        int id = traindict.Find(trainid);
+        if (id == -1 || released.Contains(id)) {
             return false;
         }
-        trainidx.Remove(hash(trainid), idx);
+        traindict.Erase(trainid);
         return true;
     }
     bool ReleaseTrain(const string20 &trainid) {
-        auto p = trainidx.Find(hash(trainid));
-        if (!p.size()) {
-            return false;
-        }
-        int idx = p[0];
-        Train train;
-        trains.read(train, idx);
-        if (released.Find(hash(trainid)).size()) {
+        TrainRecord train;
+        int id = GetTrain(trainid, train);
+        if (id == -1 || released.Contains(id)) {
             return false;
         }
+        // 先收集、排序，再批量插入各棵树
+        vector<pair<TrainInDay, int>> seatidxs;
+        vector<pair<pair<short, short>, int>> tickets;
+        vector<pair<pair<short, short>, TransferInfo>> transs;
+        vector<pair<short, short>> nexts;
         RemainSeat t;
         t.stationnum = train.stationnum;
         for (int i = 0; i < t.stationnum; i++) {
@@ -181,34 +269,45 @@ public:
                         (m == 6 ? 30 : 31);
             for (int d = db; d <= de; d++) {        
                 int idx = remainseat.write(t);
-                remainseatidx.Insert({pair{m, d}, hash(trainid)}, idx);
+                seatidxs.push_back({{pair{m, d}, id}, idx});
             }
         }
-        int sminutes = train.starttime.first * 60 + train.starttime.second;
+        remainseatidx.InsertSorted(seatidxs);
         for (int i = 0; i + 1 < train.stationnum; i++) {
-            int time = train.traveltimes[i];
-            int cost = train.prices[i];
+            int sminutes = train.leaving[i];
             MyArray<short, 2> lea, arr;
             lea[0] = sminutes % 1440 / 60, lea[1] = sminutes % 1440 % 60;
             int addday = sminutes / 1440;
             for (int j = i + 1; j < train.stationnum; j++) {
-                int minutes = sminutes + time;
+                int minutes = train.arriving[j];
                 arr[0] = minutes % 1440 / 60, arr[1] = minutes % 1440 % 60;
-                TrainTicket ticket = {trainid, (short)addday, lea, arr, (short)(minutes / 1440 - sminutes / 1440) ,(short)time, cost};
+                TrainTicket ticket = {id, (short)addday, lea, arr, (short)(minutes / 1440 - sminutes / 1440),
+                                      (short)(minutes - sminutes), train.prices[j] - train.prices[i]};
                 int idx = ticketidx.write(ticket);
-                trainticket.Insert(pair{hash(train.stations[i]), hash(train.stations[j])}, idx);
-                time += train.stopovertimes[j - 1] + train.traveltimes[j];
-                cost += train.prices[j];
+                tickets.push_back({{train.stations[i], train.stations[j]}, idx});
                 TransferInfo trans;
                 trans.ticketidx = idx;
                 trans.saledates = train.saledates;
-                transnext.Insert({hash(train.stations[i]), hash(train.stations[j])}, trans);
-                stations.Insert(hash(train.stations[i]), train.stations[j]);
+                transs.push_back({{train.stations[i], train.stations[j]}, trans});
+                nexts.push_back({train.stations[i], train.stations[j]});
             }
-            sminutes += train.traveltimes[i];
-            if (i + 1 < train.stationnum) sminutes += train.stopovertimes[i];
         }
-        released.Insert(hash(trainid), 1);
+        merge_sort(tickets, [](const auto &x, const auto &y) {
+            return x < y;
+        });
+        merge_sort(transs, [](const auto &x, const auto &y) {
+            if (x.first != y.first) {
+                return x.first < y.first;
+            }
+            return x.second.ticketidx < y.second.ticketidx;
+        });
+        merge_sort(nexts, [](const auto &x, const auto &y) {
+            return x < y;
+        });
+        trainticket.InsertSorted(tickets);
+        transnext.InsertSorted(transs);
+        stations.InsertSorted(nexts);
+        released.Insert(id, 1);
         return true;
     }
     struct TrainInfo {
@@ -217,13 +316,11 @@ public:
         int price, seat;
     };
     pair<vector<TrainInfo>, char> QueryTrain(const string20 &trainid, pair<short, short> date) {
-        auto p = trainidx.Find(hash(trainid));
-        if (!p.size()) {
+        TrainRecord train;
+        int id = GetTrain(trainid, train);
+        if (id == -1) {
             return {};
         }
-        int idx = p[0];
-        Train train;
-        trains.read(train, idx);
         int m = date.first, d = date.second;
         if (m < train.saledates.first.first || m > train.saledates.second.first
         || (m == train.saledates.first.first && d < train.saledates.first.second)
@@ -231,52 +328,15 @@ public:
             return {};
         }
         vector<TrainInfo> ans;
-        MyArray<short, 4> arr, lea;
-        arr[0] = arr[1] = arr[2] = arr[3] = -1;
-        lea[0] = m, lea[1] = d, lea[2] = train.starttime.first, lea[3] = train.starttime.second;
-        ans.push_back({train.stations[0], arr, lea, 0, train.seatnum});
-        int minutes = lea[2] * 60 + lea[3];
-        int prices = 0;
-        for (int i = 0; i + 2 < train.stationnum; i++) {
-            minutes += train.traveltimes[i];
-            if (minutes >= 1440) {
-                minutes -= 1440;
-                d++;
-            }
-            if (d > (m == 6 ? 30 : 31)) {
-                d -= (m == 6 ? 30 : 31);
-                m++;
-            }
-            arr[0] = m, arr[1] = d, arr[2] = minutes / 60, arr[3] = minutes % 60;
-            minutes += train.stopovertimes[i];
-            if (minutes >= 1440) {
-                minutes -= 1440;
-                d++;
-            }
-            if (d > (m == 6 ? 30 : 31)) {
-                d -= (m == 6 ? 30 : 31);
-                m++;
-            }
-            lea[0] = m, lea[1] = d, lea[2] = minutes / 60, lea[3] = minutes % 60;
-            prices += train.prices[i];
-            ans.push_back({train.stations[i + 1], arr, lea, prices, train.seatnum});
-        }
-        minutes += train.traveltimes[train.stationnum - 2];
-        if (minutes >= 1440) {
-            minutes -= 1440;
-            d++;
-        }
-        if (d > (m == 6 ? 30 : 31)) {
-            d -= (m == 6 ? 30 : 31);
-            m++;
-        }
-        arr[0] = m, arr[1] = d, arr[2] = minutes / 60, arr[3] = minutes % 60;
-        lea[0] = lea[1] = lea[2] = lea[3] = -1;
-        prices += train.prices[train.stationnum - 2];
-        ans.push_back({train.stations[train.stationnum - 1], arr, lea, prices, -1});
-        if (released.Find(hash(trainid)).size()) {
-            m = date.first, d = date.second;
-            int idx = remainseatidx.Find(pair{pair{m, d}, hash(trainid)})[0];
+        MyArray<short, 4> none;
+        none[0] = none[1] = none[2] = none[3] = -1;
+        int last = train.stationnum - 1;
+        for (int i = 0; i <= last; i++) {
+            ans.push_back({stationdict.Get(train.stations[i]), i == 0 ? none : At(date, train.arriving[i]),
+                           i == last ? none : At(date, train.leaving[i]), train.prices[i], i == last ? -1 : train.seatnum});
+        }
+        if (released.Contains(id)) {
+            int idx = remainseatidx.Get(pair{pair{m, d}, id}).first;
             RemainSeat p;
             remainseat.read(p, idx);
             for (int i = 0; i + 1 < train.stationnum; i++) {
@@ -286,21 +346,21 @@ public:
         return {ans, train.type};
     }
     struct TicketInfo {
-        string20 trainid;
-        string30 from, to;
+        int train;
+        string20 trainid;  // 取自已经读出的车次记录，排序和输出用
+        short from, to;
         MyArray<short, 4> arriving, leaving;
         int price, seat;
         TrainTicket ticketinfo;
     }; 
     enum class TicketOrder {kTIME, kCOST};
-    pair<TicketInfo, bool> GetTicketInfo(const TrainTicket &p, int m, int d, const string30 &st, const string30 &ed) {
+    pair<TicketInfo, bool> GetTicketInfo(const TrainTicket &p, int m, int d, short st, short ed) {
         MyArray<short, 4> lea, arr;
         TicketInfo t;
-        auto ve = trainidx.Find(hash(p.trainid));
-        int idx = ve[0];
-        Train train;
-        trains.read(train, idx);
-        t.trainid = p.trainid;
+        TrainRecord train;
+        trains.read(train, p.train);
+        t.train = p.train;
+        t.trainid = train.trainid;
         t.from = st, t.to = ed;
         lea[0] = m, lea[1] = d, lea[2] = p.leaving[0], lea[3] = p.leaving[1];
         arr[0] = m, arr[1] = d + p.deltaday, arr[2] = p.arriving[0], arr[3] = p.arriving[1];
@@ -315,36 +375,26 @@ public:
             ad += (m == 7 ? 30 : 31);
             am--;
         }
-        auto seatidxs = remainseatidx.Find(pair{pair{am, ad}, hash(t.trainid)});
-        if (!seatidxs.size()) {
+        auto [seatidx, hasseat] = remainseatidx.Get(pair{pair{am, ad}, p.train});
+        if (!hasseat) {
             return {TicketInfo(), 0};
         } 
         RemainSeat seat;
-        remainseat.read(seat, seatidxs[0]);
+        remainseat.read(seat, seatidx);
         t.seat = train.seatnum;
-        bool flag = 0;
-        for (int k = 0; k < seat.stationnum; k++) {
-            if (st == train.stations[k]) {
-                flag = 1;
-            }
-            if (ed == train.stations[k]) {
-                flag = 0;
-            }
-            if (flag) {
-                t.seat = std::min(t.seat, seat.seats[k]);
-            }
+        for (int k = Position(train, st), e = Position(train, ed); k < e; k++) {
+            t.seat = std::min(t.seat, seat.seats[k]);
         }
         t.ticketinfo = p;
         return {t, 1};
     }
-    vector<TicketInfo> QueryTicket(const string30 &st, const string30 &ed, pair<short, short> date, TicketOrder ord = TrainSystem::TicketOrder::kTIME) {
+    vector<TicketInfo> QueryTicket(short st, short ed, pair<short, short> date, TicketOrder ord = TrainSystem::TicketOrder::kTIME) {
         vector<TicketInfo> ans;
         int m = date.first, d = date.second;
-        auto ve = trainticket.Find(pair{hash(st), hash(ed)});
-        MyArray<short, 4> lea, arr;
-        for (auto pos : ve) {
+        pair<short, short> key = {st, ed};
+        for (auto it = trainticket.Seek(key); it.Valid() && it.Key() == key; it.Next()) {
             TrainTicket p;
-            ticketidx.read(p, pos);
+            ticketidx.read(p, it.Value());
             auto [t, has] = GetTicketInfo(p, m, d, st, ed);
             if (!has) {
                 continue;
@@ -375,151 +425,45 @@ public:
         int price = 0;
     };
     // 0: no train; 1: no tickets; 2: normal
-    pair<OrderInfo, int> BuyTickets(const string20 &trainid, pair<short, short> date, const string30 &st, const string30 &ed, int n) {
-        auto p = trainidx.Find(hash(trainid));
-        if (!p.size()) {
+    pair<OrderInfo, int> BuyTickets(int id, pair<short, short> date, short st, short ed, int n) {
+        if (id == -1) {
             return {OrderInfo(), 0};
         }
-        int idx = p[0];
-        Train train;
-        trains.read(train, idx);
+        TrainRecord train;
+        trains.read(train, id);
         if (n > train.seatnum) {
             return {OrderInfo(), 0};
         }
-        bool flag = 0;
-        OrderInfo order;
-        int m = date.first, d = date.second;
-        MyArray<short, 4> lea, arr;
-        int adddays = 0;
-        arr[0] = arr[1] = arr[2] = arr[3] = -1;
-        lea[0] = m, lea[1] = d, lea[2] = train.starttime.first, lea[3] = train.starttime.second;
-        int minutes = lea[2] * 60 + lea[3];
-        bool has_st = 0, has_ed = 0;
-        if (train.stations[0] == st) {
-            order.leaving = lea;
-            flag = 1;
-            has_st = 1;
-        }
-        for (int i = 0; i + 2 < train.stationnum; i++) {
-            minutes += train.traveltimes[i];
-            if (minutes >= 1440) {
-                minutes -= 1440;
-                d++;
-                if (!flag) {
-                    ++adddays;
-                }
-            }
-            if (d > (m == 6 ? 30 : 31)) {
-                d = 1;
-                m++;
-            }
-            arr[0] = m, arr[1] = d, arr[2] = minutes / 60, arr[3] = minutes % 60;
-            minutes += train.stopovertimes[i];
-            if (minutes >= 1440) {
-                minutes -= 1440;
-                d++;
-                if (!flag) {
-                    ++adddays;
-                }
-            }
-            if (d > (m == 6 ? 30 : 31)) {
-                d = 1;
-                m++;
-            }
-            lea[0] = m, lea[1] = d, lea[2] = minutes / 60, lea[3] = minutes % 60;
-            if (train.stations[i + 1] == st) {
-                order.leaving = lea;
-                flag = 1;
-                has_st = 1;
-            } else if (train.stations[i + 1] == ed) {
-                order.arriving = arr;
-                has_ed = 1;
-            }
-        }
-        minutes += train.traveltimes[train.stationnum - 2];
-        if (minutes >= 1440) {
-            minutes -= 1440;
-            d++;
-            if (!flag) {
-                ++adddays;
-            }
-        }
-        if (d > (m == 6 ? 30 : 31)) {
-            d = 1;
-            m++;
-        }
-        arr[0] = m, arr[1] = d, arr[2] = minutes / 60, arr[3] = minutes % 60;
-        lea[0] = lea[1] = lea[2] = lea[3] = -1;
-        if (train.stations[train.stationnum - 1] == ed) {
-            order.arriving = arr;
-            has_ed = 1;
-        }
-        if (!has_st || !has_ed) {
+        int s = Position(train, st), e = Position(train, ed);
+        if (s == -1 || e == -1 || s >= e) {
             return {OrderInfo(), 0};
         }
-        order.arriving[1] -= adddays;
-        if (order.arriving[1] <= 0) {
-            order.arriving[1] += (order.arriving[0] == 7 ? 30 : 31);
-            order.arriving[0]--;
-        }
-        order.leaving[1] -= adddays;
-        if (order.leaving[1] <= 0) {
-            order.leaving[1] += (order.leaving[0] == 7 ? 30 : 31);
-            order.leaving[0]--;
-        }
+        // 换算成始发日期
+        int adddays = train.leaving[s] / 1440;
         date.second -= adddays;
         if (date.second <= 0) {
             date.second += (date.first == 7 ? 30 : 31);
             date.first--;
         }
-        auto q = remainseatidx.Find(pair{date, hash(trainid)});
-        if (!q.size()) {
+        auto [seatidx, hasseat] = remainseatidx.Get(pair{date, id});
+        if (!hasseat) {
             return {OrderInfo(), 0};
         }
-        flag = 0;
-        for (int i = 0; i < train.stationnum; i++) {
-            if (train.stations[i] == st) {
-                flag = 1;
-            }
-            if (!flag && train.stations[i] == ed) {
-                return {OrderInfo(), 0};
-            }
-            if (train.stations[i] == ed) {
-                flag = 0;
-            }
-            if (flag) {
-                order.price += train.prices[i];
-            }
-        }
+        OrderInfo order;
+        order.leaving = At(date, train.leaving[s]);
+        order.arriving = At(date, train.arriving[e]);
+        order.price = train.prices[e] - train.prices[s];
         RemainSeat seats;
-        remainseat.read(seats, q[0]);
-        flag = 0;
-        for (int i = 0; i < train.stationnum; i++) {
-            if (train.stations[i] == st) {
-                flag = 1;
-            }
-            if (train.stations[i] == ed) {
-                flag = 0;
-            }
-            if (flag) {
-                if (seats.seats[i] < n) {
-                    return {order, 1};
-                }
+        remainseat.read(seats, seatidx);
+        for (int i = s; i < e; i++) {
+            if (seats.seats[i] < n) {
+                return {order, 1};
             }
         }
-        flag = 0;
-        for (int i = 0; i < train.stationnum; i++) {
-            if (train.stations[i] == st) {
-                flag = 1;
-            }
-            if (train.stations[i] == ed) {
-                flag = 0;
-            }
-            if (flag) {
-                seats.seats[i] -= n;
-            }
+        for (int i = s; i < e; i++) {
+            seats.seats[i] -= n;
         }
-        remainseat.update(seats, q[0]);
+        remainseat.update(seats, seatidx);
         return {order, 2};
     }
     struct TransferTicket {
@@ -551,30 +495,29 @@ public:
         }
         return a.second.trainid < b.second.trainid;
     }
-    pair<TransferTicket, bool> QueryTransfer(const string30 &st, const string30 &ed, pair<short, short> date, TicketOrder ord = TrainSystem::TicketOrder::kTIME) {
+    pair<TransferTicket, bool> QueryTransfer(short st, short ed, pair<short, short> date, TicketOrder ord = TrainSystem::TicketOrder::kTIME) {
         TransferTicket ans;
         bool has_ans = 0;
-        auto transstations = stations.Find(hash(st));
-        for (auto trans : transstations) {
-            auto ve = transnext.Find({hash(st), hash(trans)});
-            for (auto ti1 : ve) {
-                int pos1 = ti1.ticketidx;
+        for (auto trans = stations.Seek(st); trans.Valid() && trans.Key() == st; trans.Next()) {
+            pair<short, short> key1 = {st, trans.Value()}, key2 = {trans.Value(), ed};
+            if (!transnext.Contains(key2)) {
+                continue;
+            }
+            for (auto it1 = transnext.Seek(key1); it1.Valid() && it1.Key() == key1; it1.Next()) {
+                int pos1 = it1.Value().ticketidx;
                 TrainTicket p1;
                 ticketidx.read(p1, pos1);
-                auto [t1, has1] = GetTicketInfo(p1, date.first, date.second, st, trans);
+                auto [t1, has1] = GetTicketInfo(p1, date.first, date.second, st, trans.Value());
                 if (!has1) {
                     continue;
                 }
-                auto q = transnext.Find({hash(trans), hash(ed)});
-                if (!q.size()) {
-                    continue;
-                }
                 pair<short, short> todate = {t1.arriving[0], t1.arriving[1]};
-                for (auto ti2 : q) {
+                for (auto it2 = transnext.Seek(key2); it2.Valid() && it2.Key() == key2; it2.Next()) {
+                    auto &ti2 = it2.Value();
                     int pos2 = ti2.ticketidx;
                     TrainTicket p2;
                     ticketidx.read(p2, pos2);
-                    if (p2.trainid == t1.trainid) {
+                    if (p2.train == t1.train) {
                         continue;
                     }
                     pair<short, short> realdatel = ti2.saledates.first, realdater = ti2.saledates.second;
@@ -591,7 +534,7 @@ public:
                     } else {
                         transferdate = todate;
                     }
-                    auto [t2, has2] = GetTicketInfo(p2, transferdate.first, transferdate.second, trans, ed);
+                    auto [t2, has2] = GetTicketInfo(p2, transferdate.first, transferdate.second, trans.Value(), ed);
                     if (!has2) {
                         continue;
                     }
@@ -18,37 +18,51 @@ struct User {
     bool loggined = 0;
     // int idx;
 
-    bool operator < (const User &other) {
+    bool operator < (const User &other) const {
         return username < other.username;
     }
-    bool operator > (const User &other) {
+    bool operator > (const User &other) const {
         return username > other.username;
     }
-    bool operator == (const User &other) {
+    bool operator == (const User &other) const {
         return username == other.username;
     }
-    bool operator <= (const User &other) {
+    bool operator <= (const User &other) const {
         return !((*this) > other);
     }
-    bool operator >= (const User &other) {
+    bool operator >= (const User &other) const {
         return !((*this) < other);
     }
-    bool operator != (const User &other) {
+    bool operator != (const User &other) const {
         return !((*this) == other);
     }
 };
 
 class UserSystem {
 private:
-    BPlusTree<ull, short> useridx{"useridx"};
+    BPlusMap<ull, short, 4, 1 << 20, 1 << 16> useridx{"useridx"};
     MemoryRiver<User> users;
     BPlusTree<bool, string20> loggined{"loggined"};
 
+    // username 的记录下标（记录读进 user），没有时返回 -1 并把可以用的哈希值写入 key。
+    // 和 Dictionary 一样，哈希被别的用户占了就顺延到下一个哈希值；用户不会单独删除，顺延链不会断
+    int Probe(const string20 &username, ull &key, User &user) {
+        for (key = hash(username);; key++) {
+            auto [idx, has] = useridx.Get(key);
+            if (!has) {
+                return -1;
+            }
+            users.read(user, idx);
+            if (user.username == username) {
+                return idx;
+            }
+        }
+    }
+
 public:
+    // 登录状态不跨进程保留。放在启动时而不是析构时清除，崩溃后重启也一样
     UserSystem() {
         users.initialise("users", 1);
-    }
-    ~UserSystem() {
         auto logins = loggined.Find(1);
         for (auto p : logins) {
             auto tmp = QueryUser(p);
@@ -60,12 +74,15 @@ public:
         return users.size() == 0;
     }
 
+    // 用户名已存在时失败
     bool AddUser(const User &user) {
-        if (useridx.Find(hash(user.username)).size()) {
+        ull key;
+        User old;
+        if (Probe(user.username, key, old) != -1) {
             return false;
         }
         int idx = users.write(const_cast<User&>(user));
-        useridx.Insert(hash(user.username), idx);
+        useridx.Insert(key, idx);
         return true;
     }
     void Login(User user, int idx) {
@@ -79,13 +96,13 @@ public:
         loggined.Remove(1, user.username);
     }
     pair<User, int> QueryUser(const string20 &username) {
-        auto ve = useridx.Find(hash(username));
-        if (ve.empty()) {
+        ull key;
+        User ans;
+        int idx = Probe(username, key, ans);
+        if (idx == -1) {
             return {User(), -1};
         }
-        User ans;
-        users.read(ans, ve[0]);
-        return {ans, ve[0]};
+        return {ans, idx};
     }
     void Modify(const User &user, int idx) {
         users.update(const_cast<User&>(user), idx);
@@ -95,6 +112,11 @@ public:
         loggined.Clear();
         useridx.Clear();
     }
+    void Stats(std::ostream &os, bool full) {
+        useridx.Stats(os, full);
+        users.stats(os);
+        loggined.Stats(os, full);
+    }
 };
 
 #endif
\ No newline at end of file